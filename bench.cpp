@@ -0,0 +1,233 @@
+#include "bench.h"
+#include "movegen.h"
+#include <cstring>
+#include <stdint.h>
+
+
+const char* const Bench::BOARD_NAMES[BOARD_COUNT] = {"empty", "half_full", "near_top_out", "four_lines"};
+const char* const Bench::CASE_NAMES[CASE_COUNT] = {"clear_full_lines", "intersection", "rotate_block", "draw_blocks",
+                                                   "refresh_screen", "move_generation", "draw_numbers",
+                                                   "snapshot_restore"};
+
+
+/*
+ * Fills the field with a fixed pattern and puts a T block at the spawn position.
+ * Rows below the top get one hole each, four_lines additionally completes the
+ * bottom four rows.
+ */
+void Bench::setup_board(Tetris& tetris, Board board)
+{
+    static const uint16_t COLORS[] = {TFT_RED, TFT_BLUE, TFT_GREEN, TFT_YELLOW, TFT_CYAN, TFT_ORANGE, TFT_PURPLE};
+
+    GameCore& core = tetris.core;
+    uint8_t filled_rows = 0;
+
+    switch(board)
+    {
+        case EMPTY:
+            filled_rows = 0;
+            break;
+        case HALF_FULL:
+            filled_rows = GameCore::SQUARES_PER_COLUMN / 2;
+            break;
+        case NEAR_TOP_OUT:
+            filled_rows = GameCore::SQUARES_PER_COLUMN - 3;
+            break;
+        case FOUR_LINES:
+            filled_rows = 6;
+            break;
+        default:
+            break;
+    }
+
+    core.reset(1, Tetris::START_LEVEL);
+    core.block.init(Block::T);
+
+    uint32_t pattern = 0x9E3779B9;
+
+    for(uint8_t i = 0; i < filled_rows; i++)
+    {
+        uint8_t y = GameCore::SQUARES_PER_COLUMN - 1 - i;
+        pattern = pattern * 1664525 + 1013904223;
+
+        uint16_t row = (pattern >> 12) & GameCore::FULL_ROW;
+        row |= 1 << (pattern % GameCore::SQUARES_PER_ROW);
+        row &= ~(1 << ((pattern >> 8) % GameCore::SQUARES_PER_ROW));
+
+        if(board == FOUR_LINES && i < 4)
+        {
+            row = GameCore::FULL_ROW;
+        }
+
+        core.field_rows[y] = row;
+
+        for(uint8_t x = 0; x < GameCore::SQUARES_PER_ROW; x++)
+        {
+            core.field_colors[y][x] = COLORS[(x + y) % 7];
+        }
+    }
+
+    // The rows and the block were written directly, the hashes follow them.
+    core.update_field_hash();
+    core.update_block_hash();
+}
+
+
+/*
+ * Runs one case, returns a checksum so the work cannot be optimized away.
+ * Cases that change the field restore the occupancy rows after each call.
+ */
+uint32_t Bench::run(Tetris& tetris, Case c, uint32_t iterations)
+{
+    GameCore& core = tetris.core;
+    uint16_t rows[GameCore::SQUARES_PER_COLUMN];
+    uint32_t checksum = 0;
+
+    memcpy(rows, core.field_rows, sizeof(rows));
+
+    switch(c)
+    {
+        case CLEAR_FULL_LINES:
+            for(uint32_t i = 0; i < iterations; i++)
+            {
+                core.clear_full_lines();
+                checksum += core.field_rows[GameCore::SQUARES_PER_COLUMN - 1];
+                memcpy(core.field_rows, rows, sizeof(rows));
+            }
+            break;
+
+        case INTERSECTION:
+            for(uint32_t i = 0; i < iterations; i++)
+            {
+                core.block.center.y = i % (GameCore::SQUARES_PER_COLUMN - 1);
+                checksum += !core.fits(core.block.shape, core.block.rotation, core.block.center.x, core.block.center.y);
+            }
+            core.block.center.y = 0;
+            break;
+
+        case ROTATE_BLOCK:
+            for(uint32_t i = 0; i < iterations; i++)
+            {
+                core.rotate_block((i & 1) ? Block::LEFT : Block::RIGHT);
+                checksum += core.block.squares[0].x;
+            }
+            break;
+
+        case DRAW_BLOCKS:
+        {
+            uint16_t frame[GameCore::SQUARES_PER_COLUMN][GameCore::SQUARES_PER_ROW];
+            int8_t first[GameCore::SQUARES_PER_COLUMN];
+            int8_t last[GameCore::SQUARES_PER_COLUMN];
+
+            // Every square differs from the shown frame, so all of them are drawn.
+            for(uint32_t i = 0; i < iterations; i++)
+            {
+                memset(tetris.shown_colors, 0x01, sizeof(tetris.shown_colors));
+                tetris.compose_frame(frame);
+                tetris.draw_blocks(frame, first, last);
+                checksum += last[GameCore::SQUARES_PER_COLUMN - 1];
+            }
+            break;
+        }
+
+        case REFRESH_SCREEN:
+        {
+            static FrameSnapshot frame;
+
+            // Typical frame, the block moved one column since the last flush.
+            for(uint32_t i = 0; i < iterations; i++)
+            {
+                if(i & 1)
+                {
+                    core.move_block_left();
+                }
+                else
+                {
+                    core.move_block_right();
+                }
+
+                tetris.snapshot(frame);
+                tetris.refresh_screen(frame);
+                checksum += core.block.center.x;
+            }
+            break;
+        }
+
+        case MOVE_GENERATION:
+        {
+            static MoveGenerator generator;
+
+            for(uint32_t i = 0; i < iterations; i++)
+            {
+                checksum += generator.generate(core, core.block);
+            }
+            break;
+        }
+
+        case DRAW_NUMBERS:
+            // Six digit score and two digit level, as after a line clear.
+            for(uint32_t i = 0; i < iterations; i++)
+            {
+                tetris.display.number(100000 + i % 900000, Tetris::SCORE_RIGHT, 0, TFT_WHITE);
+                tetris.display.number(i % 30, Tetris::LEVEL_RIGHT, 0, TFT_GREENYELLOW);
+                checksum += i;
+            }
+            break;
+
+        case SNAPSHOT_RESTORE:
+        {
+            // Restore alone, as a rollout resets its copy of the game.
+            uint8_t blob[GameSnapshot::SIZE];
+            GameSnapshot::save(core, blob);
+
+            for(uint32_t i = 0; i < iterations; i++)
+            {
+                GameSnapshot::restore(blob, core);
+                checksum += core.field_rows[GameCore::SQUARES_PER_COLUMN - 1];
+            }
+            break;
+        }
+
+        default:
+            break;
+    }
+
+    return checksum;
+}
+
+
+#if defined(ARDUINO)
+
+/*
+ * Times every case with the microsecond hardware timer and prints the
+ * estimated cycles per call at the current system clock.
+ */
+void Bench::report_cycles()
+{
+    static const uint32_t ITERATIONS = 2000;
+
+    // Built once, too big for the stack and its constructor sets up the panel.
+    static Tetris tetris;
+    uint32_t mhz = rp2040.f_cpu() / 1000000;
+
+    Serial.println("case board us/op cycles/op");
+
+    for(uint8_t b = 0; b < BOARD_COUNT; b++)
+    {
+        for(uint8_t c = 0; c < CASE_COUNT; c++)
+        {
+            setup_board(tetris, Board(b));
+            tetris.publish();
+            tetris.render();
+
+            uint32_t start = Platform::micros();
+            run(tetris, Case(c), ITERATIONS);
+            uint32_t elapsed = Platform::micros() - start;
+
+            Serial.printf("%s %s %.3f %lu\n", CASE_NAMES[c], BOARD_NAMES[b], (float)elapsed / ITERATIONS,
+                          (unsigned long)((uint64_t)elapsed * mhz / ITERATIONS));
+        }
+    }
+}
+
+#endif
@@ -0,0 +1,49 @@
+#ifndef BENCH_H_
+#define BENCH_H_
+
+#include "tetris.h"
+#include <stdint.h>
+
+
+/**
+* Hot path benchmarks on synthetic boards.
+* Shared by the host bench target (host/bench_main.cpp) and the device bench
+* mode in main.ino, callers take the time around run().
+*/
+class Bench
+{
+  public:
+    enum Board
+    {
+        EMPTY,
+        HALF_FULL,
+        NEAR_TOP_OUT,
+        FOUR_LINES,
+        BOARD_COUNT
+    };
+
+    enum Case
+    {
+        CLEAR_FULL_LINES,
+        INTERSECTION,
+        ROTATE_BLOCK,
+        DRAW_BLOCKS,
+        REFRESH_SCREEN,
+        MOVE_GENERATION,
+        DRAW_NUMBERS,
+        SNAPSHOT_RESTORE,
+        CASE_COUNT
+    };
+
+    static const char* const BOARD_NAMES[BOARD_COUNT];
+    static const char* const CASE_NAMES[CASE_COUNT];
+
+    static void setup_board(Tetris& tetris, Board board);
+    static uint32_t run(Tetris& tetris, Case c, uint32_t iterations);
+
+#if defined(ARDUINO)
+    static void report_cycles();
+#endif
+};
+
+#endif
@@ -0,0 +1,517 @@
+#include "bot.h"
+#include "platform.h"
+#include <algorithm>
+#include <stdint.h>
+
+
+Bot::Bot()
+{
+    weight_height = -51;
+    weight_lines = 76;
+    weight_holes = -36;
+    weight_bumpiness = -18;
+    weight_max_height = -10;
+
+    beam_width = MAX_BEAM < 32 ? MAX_BEAM : 32;
+    depth = 1 + GameCore::PREVIEW_LENGTH;
+
+#if !defined(ARDUINO)
+    pool = nullptr;
+    generators.resize(1);
+#endif
+
+    table = nullptr;
+}
+
+
+/*
+ * Scores a field, higher is better.
+ * Lines count from the search root so clears anywhere in the sequence pay.
+ */
+int32_t Bot::evaluate(const GameCore& core, uint16_t root_lines) const
+{
+    if(core.game_over)
+    {
+        return LOSS;
+    }
+
+    return evaluate_field(core) + weight_lines * (int32_t)(core.cleared_lines - root_lines);
+}
+
+
+/*
+ * Score of the field shape alone, only depends on the occupied squares.
+ */
+int32_t Bot::evaluate_field(const GameCore& core) const
+{
+    uint8_t heights[GameCore::SQUARES_PER_ROW] = {0};
+    uint16_t seen = 0;
+    int32_t holes = 0;
+
+    for(uint8_t y = 0; y < GameCore::SQUARES_PER_COLUMN; y++)
+    {
+        uint16_t row = core.field_rows[y];
+        uint16_t fresh = row & ~seen;
+
+        holes += __builtin_popcount(seen & ~row & GameCore::FULL_ROW);
+
+        for(uint8_t x = 0; fresh; x++, fresh >>= 1)
+        {
+            if(fresh & 1)
+            {
+                heights[x] = GameCore::SQUARES_PER_COLUMN - y;
+            }
+        }
+
+        seen |= row;
+    }
+
+    int32_t aggregate = 0;
+    int32_t bumpiness = 0;
+    int32_t max_height = 0;
+
+    for(uint8_t x = 0; x < GameCore::SQUARES_PER_ROW; x++)
+    {
+        aggregate += heights[x];
+        max_height = std::max<int32_t>(max_height, heights[x]);
+
+        if(x)
+        {
+            bumpiness += abs(heights[x] - heights[x - 1]);
+        }
+    }
+
+    return weight_height * aggregate + weight_holes * holes + weight_bumpiness * bumpiness + weight_max_height * max_height;
+}
+
+
+/*
+ * Scores every placement of one beam node.
+ * Expansion stops once the time budget is used up, except for the root.
+ */
+void Bot::expand(uint8_t node, MoveGenerator& generator, bool root)
+{
+    child_count[node] = 0;
+
+    if(!root && budget && Platform::micros() - start_time > budget)
+    {
+        expired = true;
+    }
+
+    if(expired)
+    {
+        return;
+    }
+
+    const GameCore& core = nodes[current][node];
+    MoveGenerator& moves = root ? root_moves : generator;
+    uint8_t count = moves.generate(core, core.block);
+    Child* out = &children[node * MoveGenerator::MAX_PLACEMENTS];
+
+    for(uint8_t i = 0; i < count; i++)
+    {
+        const Placement& p = moves.placements[i];
+
+        out[i].x = p.x;
+        out[i].y = p.y;
+        out[i].rotation = p.rotation;
+        out[i].hash = 0;
+        out[i].parent = node;
+        out[i].first = root ? i : first[current][node];
+
+        // Locking in the spawn row ends the game.
+        if(GameCore::tops_out(p.y))
+        {
+            out[i].value = LOSS;
+            continue;
+        }
+
+        GameCore child(core);
+        MoveGenerator::place(child.block, p);
+        child.finish_block();
+        out[i].hash = child.field_hash;
+
+        int32_t value;
+        uint16_t best;
+        uint8_t cached_depth;
+
+        // Different move orders often end in the same field.
+        if(!table || !table->probe(child.field_hash, value, best, cached_depth))
+        {
+            value = evaluate_field(child);
+
+            if(table)
+            {
+                table->store(child.field_hash, value, NO_MOVE, 0);
+            }
+        }
+
+        out[i].value = value + weight_lines * (int32_t)(child.cleared_lines - root_lines);
+    }
+
+    child_count[node] = count;
+}
+
+
+/*
+ * Expands all nodes of the current beam, in parallel where a pool exists.
+ */
+void Bot::expand_level(bool root)
+{
+#if !defined(ARDUINO)
+    if(pool && node_count > 1)
+    {
+        // Workers never share a generator, its search state is per call.
+        if(generators.size() < pool->size())
+        {
+            generators.resize(pool->size());
+        }
+
+        pool->run(node_count, [this, root](uint32_t node, unsigned worker) {
+            expand(node, generators[worker], root);
+        });
+        return;
+    }
+#endif
+
+    for(uint8_t node = 0; node < node_count; node++)
+    {
+        expand(node, generators[0], root);
+    }
+}
+
+
+/*
+ * Table key of a search root, the field and block plus the preview queue.
+ */
+uint64_t Bot::root_key(const GameCore& root)
+{
+    uint64_t key = root.hash();
+
+    for(uint8_t i = 0; i < GameCore::PREVIEW_LENGTH; i++)
+    {
+        key ^= GameCore::ZOBRIST.blocks[root.preview[i]][(i + 1) & 3] ^
+               GameCore::ZOBRIST.centers_y[ZobristKeys::CENTERS_Y - 1 - i];
+    }
+
+    return key;
+}
+
+
+/*
+ * Chooses a placement for the current block of root.
+ * Returns false if the block has nowhere to go.
+ */
+bool Bot::search(const GameCore& root, uint32_t budget_us, Placement& best)
+{
+    current = 0;
+    node_count = 1;
+    nodes[0][0] = root;
+    root_lines = root.cleared_lines;
+    start_time = Platform::micros();
+    budget = budget_us;
+    expired = false;
+
+    int16_t best_first = -1;
+    int32_t best_value = LOSS;
+    uint64_t key = root_key(root);
+
+    // A decision for this exact position and depth was made before.
+    if(table)
+    {
+        int32_t value;
+        uint16_t best_move;
+        uint8_t cached_depth;
+
+        table->new_search();
+
+        if(table->probe(key, value, best_move, cached_depth) && best_move != NO_MOVE && cached_depth >= depth &&
+           best_move < root_moves.generate(root, root.block))
+        {
+            best = root_moves.placements[best_move];
+            return true;
+        }
+    }
+
+    for(uint8_t d = 0; d < depth; d++)
+    {
+        expand_level(d == 0);
+
+        if(expired)
+        {
+            break;
+        }
+
+        uint16_t total = 0;
+
+        for(uint8_t node = 0; node < node_count; node++)
+        {
+            for(uint8_t i = 0; i < child_count[node]; i++)
+            {
+                order[total++] = node * MoveGenerator::MAX_PLACEMENTS + i;
+            }
+        }
+
+        if(!total)
+        {
+            break;
+        }
+
+        uint16_t keep = std::min<uint16_t>(total, beam_width);
+
+        std::partial_sort(order, order + keep, order + total,
+                          [this](uint16_t a, uint16_t b) { return children[a].value > children[b].value; });
+
+        best_first = children[order[0]].first;
+        best_value = children[order[0]].value;
+
+        if(d + 1 == depth)
+        {
+            break;
+        }
+
+        uint8_t next = current ^ 1;
+        uint8_t next_count = 0;
+
+        for(uint16_t j = 0; j < keep && children[order[j]].value != LOSS; j++)
+        {
+            const Child& c = children[order[j]];
+            GameCore& n = nodes[next][next_count];
+            Placement p;
+            bool duplicate = false;
+
+            // Transpositions would only fill the beam with copies.
+            for(uint8_t k = 0; k < next_count && !duplicate; k++)
+            {
+                duplicate = kept[k] == c.hash;
+            }
+
+            if(duplicate)
+            {
+                continue;
+            }
+
+            kept[next_count] = c.hash;
+
+            p.x = c.x;
+            p.y = c.y;
+            p.rotation = c.rotation;
+
+            n = nodes[current][c.parent];
+            MoveGenerator::place(n.block, p);
+            n.finish_block();
+            first[next][next_count++] = c.first;
+        }
+
+        if(!next_count)
+        {
+            break;
+        }
+
+        current = next;
+        node_count = next_count;
+    }
+
+    if(best_first < 0)
+    {
+        return false;
+    }
+
+    if(table && !expired)
+    {
+        table->store(key, best_value, best_first, depth);
+    }
+
+    best = root_moves.placements[best_first];
+    return true;
+}
+
+
+Autoplayer::Autoplayer()
+{
+    synchronous = false;
+    request_piece = 0;
+    request_sequence = 0;
+    result_piece = 0;
+    planned_piece = 0;
+    target_key = 0;
+    plan.path_length = 0;
+    plan_index = 0;
+}
+
+
+/*
+ * Runs a pending search request, on the second core of the device.
+ * The block keeps falling meanwhile, so off the host the search gets two
+ * rows of gravity as budget.
+ */
+void Autoplayer::think()
+{
+    uint32_t sequence = __atomic_load_n(&request_sequence, __ATOMIC_ACQUIRE);
+    uint32_t piece = request_piece;
+
+    if((sequence & 1) || !piece || piece == result_piece)
+    {
+        return;
+    }
+
+    GameCore root(request);
+    __sync_synchronize();
+
+    // Written while copying, the copy may be torn, the newer request is taken next time.
+    if(__atomic_load_n(&request_sequence, __ATOMIC_RELAXED) != sequence)
+    {
+        return;
+    }
+
+    uint32_t budget_us = synchronous ? 0 : 2 * GameCore::GRAVITY.frames[root.level] * (1000000 / GameCore::FRAME_RATE);
+
+    if(!bot.search(root, budget_us, result))
+    {
+        result.key = 0;
+    }
+
+    __sync_synchronize();
+    result_piece = piece;
+}
+
+
+/*
+ * Path from the current block position to the target placement.
+ */
+bool Autoplayer::replan(const GameCore& core)
+{
+    replanner.generate(core, core.block);
+
+    cursor_x = core.block.center.x;
+    cursor_y = core.block.center.y;
+    cursor_rotation = core.block.rotation;
+    plan_index = 0;
+    plan.path_length = 0;
+
+    for(uint8_t i = 0; i < replanner.count; i++)
+    {
+        if(replanner.placements[i].key == target_key)
+        {
+            plan = replanner.placements[i];
+            return true;
+        }
+    }
+
+    return false;
+}
+
+
+/*
+ * Buttons to press in the next frame, at most one per frame.
+ */
+FrameInputs Autoplayer::inputs(const GameCore& core)
+{
+    if(core.game_over)
+    {
+        return 0;
+    }
+
+    if(request_piece != core.pieces)
+    {
+        uint32_t sequence = request_sequence;
+
+        __atomic_store_n(&request_sequence, sequence + 1, __ATOMIC_RELAXED);
+        __sync_synchronize();
+        request = core;
+        request_piece = core.pieces;
+        __atomic_store_n(&request_sequence, sequence + 2, __ATOMIC_RELEASE);
+
+        if(synchronous)
+        {
+            think();
+        }
+    }
+
+    if(planned_piece != core.pieces)
+    {
+        if(result_piece != core.pieces)
+        {
+            return 0;
+        }
+
+        __sync_synchronize();
+        target_key = result.key;
+        planned_piece = core.pieces;
+
+        if(!replan(core))
+        {
+            return 0;
+        }
+    }
+
+    const Block& b = core.block;
+
+    // Planned drops that gravity already performed.
+    while(plan_index < plan.path_length && plan.path[plan_index] == MoveGenerator::DOWN && b.center.y > cursor_y)
+    {
+        cursor_y++;
+        plan_index++;
+    }
+
+    if(b.center.x != cursor_x || b.center.y != cursor_y || b.rotation != cursor_rotation)
+    {
+        if(!replan(core))
+        {
+            return 0;
+        }
+    }
+
+    if(plan_index >= plan.path_length)
+    {
+        return 0;
+    }
+
+    switch(plan.path[plan_index])
+    {
+        case MoveGenerator::LEFT:
+            plan_index++;
+            cursor_x++;
+            return GameCore::MOVE_LEFT;
+
+        case MoveGenerator::RIGHT:
+            plan_index++;
+            cursor_x--;
+            return GameCore::MOVE_RIGHT;
+
+        case MoveGenerator::ROTATE_LEFT:
+            plan_index++;
+            track_rotation(core, Block::LEFT);
+            return GameCore::ROTATE_LEFT;
+
+        case MoveGenerator::ROTATE_RIGHT:
+            plan_index++;
+            track_rotation(core, Block::RIGHT);
+            return GameCore::ROTATE_RIGHT;
+
+        case MoveGenerator::WAIT:
+            plan_index++;
+            return 0;
+    }
+
+    return 0;
+}
+
+
+/*
+ * Expected block position after a planned rotation, wall kicks may move it.
+ */
+void Autoplayer::track_rotation(const GameCore& core, Block::Direction d)
+{
+    const Block& b = core.block;
+    int8_t k = core.rotation_kick(b.shape, b.rotation, d, b.center.x, b.center.y);
+
+    if(k < 0)
+    {
+        return;
+    }
+
+    cursor_x = b.center.x + Block::PIECES.kicks[b.shape][b.rotation][d][k].x;
+    cursor_y = b.center.y + Block::PIECES.kicks[b.shape][b.rotation][d][k].y;
+    cursor_rotation = Block::turn(b.shape, b.rotation, d);
+}
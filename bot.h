@@ -0,0 +1,135 @@
+#ifndef BOT_H_
+#define BOT_H_
+
+#include "game_core.h"
+#include "movegen.h"
+#include "transposition.h"
+#include <stdint.h>
+
+#if !defined(ARDUINO)
+#include "host/work_pool.h"
+#include <vector>
+#endif
+
+
+/**
+* Beam search over the current block and the preview queue.
+* Every beam node is expanded with the move generator, children are scored
+* by a weighted sum of field features and the best ones form the next beam.
+*/
+class Bot
+{
+  public:
+#if defined(ARDUINO)
+    static const uint8_t MAX_BEAM = 8;
+#else
+    static const uint8_t MAX_BEAM = 64;
+#endif
+
+    static const int32_t LOSS = -1000000000;
+    static const uint16_t NO_MOVE = 0xFFFF;
+
+    // Feature weights, per square of height, per line and so on.
+    int16_t weight_height;
+    int16_t weight_lines;
+    int16_t weight_holes;
+    int16_t weight_bumpiness;
+    int16_t weight_max_height;
+
+    uint8_t beam_width;
+    // Blocks searched, the current one plus up to PREVIEW_LENGTH previews.
+    uint8_t depth;
+
+#if !defined(ARDUINO)
+    // Pool that expands beam nodes in parallel, serial if not set.
+    WorkPool* pool;
+#endif
+
+    // Cache of field evaluations and root decisions, optional.
+    TranspositionTable* table;
+
+    Bot();
+    int32_t evaluate(const GameCore& core, uint16_t root_lines) const;
+    int32_t evaluate_field(const GameCore& core) const;
+    bool search(const GameCore& root, uint32_t budget_us, Placement& best);
+
+  private:
+    struct Child
+    {
+        uint64_t hash;
+        int32_t value;
+        int8_t x;
+        int8_t y;
+        uint8_t rotation;
+        uint8_t parent;
+        uint8_t first;
+    };
+
+    GameCore nodes[2][MAX_BEAM];
+    uint8_t first[2][MAX_BEAM];
+    uint8_t current;
+    uint8_t node_count;
+    uint16_t root_lines;
+    uint32_t start_time;
+    uint32_t budget;
+    volatile bool expired;
+
+    Child children[MAX_BEAM * MoveGenerator::MAX_PLACEMENTS];
+    uint16_t order[MAX_BEAM * MoveGenerator::MAX_PLACEMENTS];
+    uint64_t kept[MAX_BEAM];
+    uint8_t child_count[MAX_BEAM];
+    MoveGenerator root_moves;
+#if defined(ARDUINO)
+    MoveGenerator generators[1];
+#else
+    // One per pool worker, grown to the pool size before a parallel level.
+    std::vector<MoveGenerator> generators;
+#endif
+
+    static uint64_t root_key(const GameCore& root);
+    void expand(uint8_t node, MoveGenerator& generator, bool root);
+    void expand_level(bool root);
+};
+
+
+/**
+* Plays through the same button flags a human uses.
+* A search is requested whenever a new block spawns, the chosen placement
+* is then reached one input per frame, replanning from the actual block
+* position whenever gravity got ahead of the plan.
+*/
+class Autoplayer
+{
+  public:
+    Bot bot;
+    // Search inside inputs() instead of waiting for think() on another core.
+    bool synchronous;
+
+    Autoplayer();
+    FrameInputs inputs(const GameCore& core);
+    void think();
+
+  private:
+    // Search request and result, handed over between the cores. The request
+    // is guarded by a sequence count that is odd while inputs() writes it.
+    GameCore request;
+    volatile uint32_t request_piece;
+    uint32_t request_sequence;
+    volatile uint32_t result_piece;
+    Placement result;
+
+    // Placement being executed.
+    uint32_t planned_piece;
+    uint64_t target_key;
+    Placement plan;
+    uint8_t plan_index;
+    int8_t cursor_x;
+    int8_t cursor_y;
+    uint8_t cursor_rotation;
+    MoveGenerator replanner;
+
+    bool replan(const GameCore& core);
+    void track_rotation(const GameCore& core, Block::Direction d);
+};
+
+#endif
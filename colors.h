@@ -0,0 +1,10 @@
+#ifndef COLORS_H_
+#define COLORS_H_
+
+#if defined(ARDUINO)
+#include <TFT_eSPI.h>
+#else
+#include "host/tft_colors.h"
+#endif
+
+#endif
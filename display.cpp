@@ -1,6 +1,7 @@
 #include "display.h"
-#include <sys/_stdint.h>
 #include "Free_Fonts.h"
+#include "trace.h"
+#include <stdint.h>
 
 
 Display::Display()
@@ -8,7 +9,17 @@ Display::Display()
     tft.init();
     tft.setRotation(2);
 
+#if DISPLAY_BPP == 4
+    // Flush sends native RGB565 words, the panel wants the high byte first.
+    tft.setSwapBytes(true);
+    sprite.setColorDepth(4);
     sprite.createSprite(WIDTH, HEIGHT);
+    sprite.createPalette(PALETTE, PALETTE_SIZE);
+#else
+    sprite.createSprite(WIDTH, HEIGHT);
+#endif
+
+    rasterize_digits();
 }
 
 /*
@@ -16,7 +27,7 @@ Display::Display()
 */
 void Display::line(uint8_t x1, uint8_t y1, uint8_t x2, uint8_t y2, uint32_t color)
 {
-    sprite.drawLine(x1, y1, x2, y2, color);
+    sprite.drawLine(x1, y1, x2, y2, ink(color));
 }
 
 /**
@@ -24,31 +35,144 @@ void Display::line(uint8_t x1, uint8_t y1, uint8_t x2, uint8_t y2, uint32_t colo
  */
 void Display::vline(uint8_t x1, uint8_t y1, uint8_t length, uint32_t color)
 {
-    sprite.drawLine(x1, y1, x1, y1 + length, color);
+    sprite.drawLine(x1, y1, x1, y1 + length, ink(color));
 }
 
+/*
+* Sprite buffer, packed 4 bit palette indices in 4 bpp mode.
+*/
+uint8_t* Display::pixels() { return (uint8_t*)sprite.getPointer(); }
+
+
 /*
 * Filled rectangle.
 */
 void Display::filled_rectangle(uint8_t x, uint8_t y, uint8_t width, uint8_t height, uint32_t color)
 {
-    sprite.fillRect(x, y, width, height, color);
+    sprite.fillRect(x, y, width, height, ink(color));
 }
 
 
+/*
+* Right aligned number with its top right corner at (x, y), over a box of
+* TEXT_BACKGROUND like drawRightString() with a free font draws it.
+* Glyphs come from the digit atlas and are written straight into the sprite
+* buffer.
+*/
 void Display::number(uint32_t number, uint16_t x, uint16_t y, uint32_t color)
 {
-    sprite.setTextColor(color, TFT_DARKGREY);
-    sprite.setFreeFont(FSB9); 
-    sprite.drawRightString(String(number), x, y, GFXFF);
+    uint8_t glyphs[DigitAtlas::MAX_DIGITS];
+    uint8_t count = DigitAtlas::format(number, glyphs);
+    int16_t left = x - digits.width(glyphs, count);
+
+    sprite.fillRect(left, y, x - left, digits.height, ink(TEXT_BACKGROUND));
+
+#if DISPLAY_BPP == 4
+    uint8_t* pixels = (uint8_t*)sprite.getPointer();
+    uint8_t index = ink(color);
+#endif
+
+    for(uint8_t i = count; i-- > 0; left += digits.advance[glyphs[i]])
+    {
+        const uint16_t* glyph = digits.rows[glyphs[i]];
+
+        for(uint8_t row = 0; row < digits.height && y + row < HEIGHT; row++)
+        {
+            for(uint8_t column = 0; column < DigitAtlas::MAX_WIDTH; column++)
+            {
+                int16_t px = left + column;
+
+                if(!(glyph[row] & (0x8000 >> column)) || px < 0 || px >= WIDTH)
+                {
+                    continue;
+                }
+
+#if DISPLAY_BPP == 4
+                uint8_t& pair = pixels[((y + row) * WIDTH + px) / 2];
+                pair = px & 1 ? (pair & 0xF0) | index : (pair & 0x0F) | index << 4;
+#else
+                sprite.drawPixel(px, y + row, color);
+#endif
+            }
+        }
+    }
+}
+
+
+/*
+* Right aligned FSB9 text with its top right corner at (x, y) over a box of
+* TEXT_BACKGROUND, the way the digit atlas is filled.
+*/
+void Display::text_right(const char* text, uint16_t x, uint16_t y, uint32_t color)
+{
+    sprite.setFreeFont(FSB9);
+    sprite.setTextColor(ink(color), ink(TEXT_BACKGROUND));
+    sprite.drawRightString(text, x, y, GFXFF);
 }
 
+
+/*
+* Width of text in FSB9, the sum of the glyph advances for digits.
+*/
+uint16_t Display::text_width(const char* text)
+{
+    sprite.setFreeFont(FSB9);
+    return sprite.textWidth(text, GFXFF);
+}
+
+
+/*
+* Value the sprite holds at (x, y), a palette index in palette mode.
+*/
+uint32_t Display::read_pixel(uint8_t x, uint8_t y) { return sprite.readPixelValue(x, y); }
+
 /*
 * Fill display with color.
 */
-void Display::fill(uint32_t color) { sprite.fillScreen(color); }
+void Display::fill(uint32_t color) { sprite.fillScreen(ink(color)); }
 
 /*
 * Flush sprite buffer into display.
 */
-void Display::flush() { sprite.pushSprite(0, 0); }
+void Display::flush() { flush(0, 0, WIDTH, HEIGHT); }
+
+
+/*
+* Flush a window of the sprite buffer into the same window of the display.
+* In palette mode every line is expanded to RGB565 right before it is sent.
+*/
+void Display::flush(uint8_t x, uint8_t y, uint8_t width, uint8_t height)
+{
+    TRACE_SPAN(FLUSH);
+
+#if DISPLAY_BPP == 4
+    const uint8_t* pixels = (const uint8_t*)sprite.getPointer();
+    uint16_t line[WIDTH];
+
+    if(x >= WIDTH || y >= HEIGHT)
+    {
+        return;
+    }
+
+    width = x + width > WIDTH ? WIDTH - x : width;
+    height = y + height > HEIGHT ? HEIGHT - y : height;
+
+    tft.startWrite();
+    tft.setAddrWindow(x, y, width, height);
+
+    for(uint8_t row = y; row < y + height; row++)
+    {
+        for(uint8_t column = x; column < x + width; column++)
+        {
+            uint8_t pair = pixels[(row * WIDTH + column) / 2];
+            line[column - x] = PALETTE[column & 1 ? pair & 0xF : pair >> 4];
+        }
+
+        tft.pushPixels(line, width);
+    }
+
+    tft.endWrite();
+#else
+    sprite.pushSprite(x, y, x, y, width, height);
+#endif
+}
@@ -1,29 +1,258 @@
 #ifndef DISPLAY_H_
 #define DISPLAY_H_
 
-#include <sys/_stdint.h>
+#include <stdint.h>
+
+#include "colors.h"
+
+#if defined(ARDUINO)
 #include <TFT_eSPI.h>
 #include <SPI.h>
+#endif
+
+// Bits per pixel of the frame buffer. 4 stores palette indices and expands
+// them to RGB565 while flushing, 16 stores RGB565.
+#ifndef DISPLAY_BPP
+#define DISPLAY_BPP 4
+#endif
+
+
+/**
+* Digit glyphs for score and level, filled at startup by
+* Display::rasterize_digits() from what the text font draws. Glyph rows start
+* at the left edge of the digit cell.
+*/
+class DigitAtlas
+{
+  public:
+    // Cell bounds, FSB9 draws its digits 10 pixels apart on 22 pixel lines.
+    static const uint8_t MAX_WIDTH = 16;
+    static const uint8_t MAX_HEIGHT = 22;
+    // Digits of the largest uint32_t.
+    static const uint8_t MAX_DIGITS = 10;
+
+    // Glyph rows with the leftmost pixel in bit 15, the advance of every
+    // digit and the height of the background box behind a number.
+    uint16_t rows[10][MAX_HEIGHT];
+    uint8_t advance[10];
+    uint8_t height;
+
+    constexpr DigitAtlas() : rows(), advance(), height(0) {}
+
+    /*
+    * Width of number as drawn, the sum of its digit cells.
+    */
+    uint16_t width(const uint8_t* digits, uint8_t count) const
+    {
+        uint16_t sum = 0;
+
+        for(uint8_t i = 0; i < count; i++)
+        {
+            sum += advance[digits[i]];
+        }
+
+        return sum;
+    }
+
+    /*
+    * Decimal digits of number into a caller buffer of MAX_DIGITS, the least
+    * significant first. Returns the number of digits.
+    */
+    static uint8_t format(uint32_t number, uint8_t digits[MAX_DIGITS])
+    {
+        uint8_t count = 0;
+
+        do
+        {
+            digits[count++] = number % 10;
+            number /= 10;
+        } while(number);
+
+        return count;
+    }
+};
+
+
+/**
+* Square tiles of every palette color, flat or with a bevel, generated at
+* compile time. Rows are packed for the 4 bit frame buffer for both pixel
+* parities, so a blit only merges the nibbles at the two edges. At an even x
+* a row is 5 whole bytes, at an odd x the first byte only carries its low
+* nibble and the sixth only its high one.
+*/
+class TileAtlas
+{
+  public:
+    static const uint8_t SIZE = 10;
+    static const uint8_t COLORS = 16;
+    static const uint8_t ROW_BYTES = SIZE / 2 + 1;
+
+    uint8_t rows[2][COLORS][2][SIZE][ROW_BYTES];
+
+    constexpr TileAtlas(uint8_t light, uint8_t dark) : rows()
+    {
+        for(uint8_t bevel = 0; bevel < 2; bevel++)
+        {
+            for(uint8_t color = 0; color < COLORS; color++)
+            {
+                for(uint8_t y = 0; y < SIZE; y++)
+                {
+                    uint8_t line[SIZE] = {};
 
+                    // Lit from the top left, the shadow wins at the corners.
+                    for(uint8_t x = 0; x < SIZE; x++)
+                    {
+                        line[x] = !bevel                        ? color
+                                  : x == SIZE - 1 || y == SIZE - 1 ? dark
+                                  : x == 0 || y == 0              ? light
+                                                                  : color;
+                    }
 
+                    for(uint8_t k = 0; k < SIZE / 2; k++)
+                    {
+                        rows[bevel][color][0][y][k] = line[2 * k] << 4 | line[2 * k + 1];
+                    }
 
+                    rows[bevel][color][1][y][0] = line[0];
+
+                    for(uint8_t k = 1; k < SIZE / 2; k++)
+                    {
+                        rows[bevel][color][1][y][k] = line[2 * k - 1] << 4 | line[2 * k];
+                    }
+
+                    rows[bevel][color][1][y][SIZE / 2] = line[SIZE - 1] << 4;
+                }
+            }
+        }
+    }
+};
+
+
+/**
+* The tiles of a TileAtlas as RGB565 blocks for the 16 bit frame buffer,
+* SIZE rows of SIZE pixels per tile.
+*/
+class TileAtlas565
+{
+  public:
+    uint16_t pixels[2][TileAtlas::COLORS][TileAtlas::SIZE * TileAtlas::SIZE];
+
+    constexpr TileAtlas565(const TileAtlas& tiles, const uint16_t* palette) : pixels()
+    {
+        for(uint8_t bevel = 0; bevel < 2; bevel++)
+        {
+            for(uint8_t color = 0; color < TileAtlas::COLORS; color++)
+            {
+                for(uint8_t y = 0; y < TileAtlas::SIZE; y++)
+                {
+                    for(uint8_t x = 0; x < TileAtlas::SIZE; x++)
+                    {
+                        uint8_t pair = tiles.rows[bevel][color][0][y][x / 2];
+                        pixels[bevel][color][y * TileAtlas::SIZE + x] = palette[x & 1 ? pair & 0xF : pair >> 4];
+                    }
+                }
+            }
+        }
+    }
+};
+
+
+/**
+* Display policy, TFT_eSPI sprite on the device and an in-memory frame buffer
+* on the host (host/display_host.cpp). Colors are RGB565 values, in palette
+* mode they are looked up in PALETTE and colors missing there draw black.
+*/
 class Display
 {
   private:
   public:
     static const uint16_t WIDTH = 128;
     static const uint16_t HEIGHT = 160;
+    static const uint8_t PALETTE_SIZE = 16;
+    // Palette slots of the tile bevel.
+    static const uint8_t INK_BLACK = 0;
+    static const uint8_t INK_WHITE = 2;
+    static constexpr TileAtlas TILES = TileAtlas(INK_WHITE, INK_BLACK);
+    // Color of the box behind numbers, as TFT_eSPI fills it for free fonts.
+    static const uint16_t TEXT_BACKGROUND = TFT_DARKGREY;
+    // Every color the game draws, the last slots are free.
+    static constexpr uint16_t PALETTE[PALETTE_SIZE] = {TFT_BLACK,  TFT_DARKGREY, TFT_WHITE, TFT_GREENYELLOW,
+                                                       TFT_SKYBLUE, TFT_RED,     TFT_BLUE,  TFT_GREEN,
+                                                       TFT_YELLOW, TFT_CYAN,     TFT_ORANGE, TFT_PURPLE};
+#if DISPLAY_BPP != 4
+    static constexpr TileAtlas565 TILES_565 = TileAtlas565(TILES, PALETTE);
+#endif
 
+#if defined(ARDUINO)
     TFT_eSPI tft = TFT_eSPI();
     TFT_eSprite sprite = TFT_eSprite(&tft);
+#else
+    // Drawing target, two pixels per byte in palette mode with the left one in
+    // the high nibble, and the panel content as of the last flush.
+#if DISPLAY_BPP == 4
+    typedef uint8_t* Pixels;
+    uint8_t framebuffer[WIDTH * HEIGHT / 2];
+#else
+    typedef uint16_t* Pixels;
+    uint16_t framebuffer[WIDTH * HEIGHT];
+#endif
+    uint16_t panel[WIDTH * HEIGHT];
+    // Pixels pushed to the panel so far.
+    uint32_t flushed_pixels;
+#endif
+
+    // Score and level glyphs.
+    DigitAtlas digits;
 
     Display();
+
+    /*
+    * Palette slot of a color, colors missing in the palette get slot 0.
+    */
+    static uint8_t palette_index(uint32_t color)
+    {
+        for(uint8_t i = 0; i < PALETTE_SIZE; i++)
+        {
+            if(PALETTE[i] == color)
+            {
+                return i;
+            }
+        }
+
+        return 0;
+    }
+
+    /*
+    * Value the frame buffer stores for a color, its palette index in palette mode.
+    */
+    static uint32_t ink(uint32_t color)
+    {
+#if DISPLAY_BPP == 4
+        return palette_index(color);
+#else
+        return color;
+#endif
+    }
+
     void line(uint8_t x1, uint8_t y1, uint8_t x2, uint8_t y2, uint32_t color);
     void vline(uint8_t x1, uint8_t y1, uint8_t length, uint32_t color);
     void filled_rectangle(uint8_t x, uint8_t y, uint8_t width, uint8_t height, uint32_t color);
+    uint8_t* pixels();
+    void tile(uint8_t x, uint8_t y, uint32_t color, bool bevel);
+    void tile_row(uint8_t x, uint8_t y, const uint16_t* colors, uint8_t count, uint8_t step, uint32_t flat);
     void number(uint32_t number, uint16_t x, uint16_t y, uint32_t color);
+    void text_right(const char* text, uint16_t x, uint16_t y, uint32_t color);
+    uint16_t text_width(const char* text);
+    uint32_t read_pixel(uint8_t x, uint8_t y);
     void fill(uint32_t color);
     void flush();
+    void flush(uint8_t x, uint8_t y, uint8_t width, uint8_t height);
+
+  private:
+    void rasterize_digits();
 };
 
+static_assert(Display::PALETTE[Display::INK_BLACK] == TFT_BLACK && Display::PALETTE[Display::INK_WHITE] == TFT_WHITE,
+              "tile bevel slots do not match the palette");
+
 #endif
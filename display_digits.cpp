@@ -0,0 +1,49 @@
+#include "display.h"
+#include <stdint.h>
+
+
+/*
+* Draws every digit with text_right() into the top left corner of the frame
+* buffer and reads the pixels back into the atlas, so numbers drawn from it
+* look exactly like the text font draws them. A digit advances by its text
+* width, white is the ink and anything else but the black canvas the
+* background box.
+*/
+void Display::rasterize_digits()
+{
+    digits.height = 0;
+
+    for(uint8_t digit = 0; digit < 10; digit++)
+    {
+        char text[2] = {(char)('0' + digit), 0};
+        uint16_t advance = text_width(text);
+        uint8_t left = advance < DigitAtlas::MAX_WIDTH ? DigitAtlas::MAX_WIDTH - advance : 0;
+
+        filled_rectangle(0, 0, DigitAtlas::MAX_WIDTH, DigitAtlas::MAX_HEIGHT, TFT_BLACK);
+        text_right(text, DigitAtlas::MAX_WIDTH, 0, TFT_WHITE);
+
+        for(uint8_t row = 0; row < DigitAtlas::MAX_HEIGHT; row++)
+        {
+            uint16_t bits = 0;
+
+            for(uint8_t column = 0; column < DigitAtlas::MAX_WIDTH; column++)
+            {
+                uint32_t value = read_pixel(column, row);
+
+                if(value != ink(TFT_BLACK) && row + 1 > digits.height)
+                {
+                    digits.height = row + 1;
+                }
+
+                if(value == ink(TFT_WHITE) && column >= left)
+                {
+                    bits |= 0x8000 >> (column - left);
+                }
+            }
+
+            digits.rows[digit][row] = bits;
+        }
+
+        digits.advance[digit] = DigitAtlas::MAX_WIDTH - left;
+    }
+}
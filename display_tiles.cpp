@@ -0,0 +1,87 @@
+#include "display.h"
+#include <stdint.h>
+#include <string.h>
+
+
+/*
+* Copies one packed tile row to the 4 bit frame buffer at (x, y).
+*/
+static inline void blit_row(uint8_t* pixels, uint8_t x, uint8_t y, const uint8_t* row)
+{
+    uint8_t* target = pixels + (y * Display::WIDTH + x) / 2;
+
+    if(!(x & 1))
+    {
+        memcpy(target, row, TileAtlas::SIZE / 2);
+        return;
+    }
+
+    target[0] = (target[0] & 0xF0) | row[0];
+    memcpy(target + 1, row + 1, TileAtlas::SIZE / 2 - 1);
+    target[TileAtlas::SIZE / 2] = (target[TileAtlas::SIZE / 2] & 0x0F) | row[TileAtlas::SIZE / 2];
+}
+
+
+/*
+* Tile of the given color with its top left corner at (x, y), not clipped.
+* Rows are copied from the atlas, in 16 bpp mode from its RGB565 copy. The
+* sprite keeps 16 bit pixels byte swapped, so there pushImage() copies them.
+*/
+void Display::tile(uint8_t x, uint8_t y, uint32_t color, bool bevel)
+{
+#if DISPLAY_BPP == 4
+    uint8_t* target = pixels();
+    const uint8_t(*rows)[TileAtlas::ROW_BYTES] = TILES.rows[bevel][ink(color)][x & 1];
+
+    for(uint8_t row = 0; row < TileAtlas::SIZE; row++)
+    {
+        blit_row(target, x, y + row, rows[row]);
+    }
+#else
+    const uint16_t* block = TILES_565.pixels[bevel][palette_index(color)];
+
+#if defined(ARDUINO)
+    sprite.pushImage(x, y, TileAtlas::SIZE, TileAtlas::SIZE, block);
+#else
+    uint16_t* target = (uint16_t*)pixels();
+
+    for(uint8_t row = 0; row < TileAtlas::SIZE; row++)
+    {
+        memcpy(target + (y + row) * WIDTH + x, block + row * TileAtlas::SIZE, TileAtlas::SIZE * sizeof(uint16_t));
+    }
+#endif
+#endif
+}
+
+
+/*
+* Row of count tiles, step pixels apart, all tiles bevelled except those of
+* the flat color. The frame buffer is walked line by line, so a whole row of
+* the field is drawn in one pass from top to bottom.
+*/
+void Display::tile_row(uint8_t x, uint8_t y, const uint16_t* colors, uint8_t count, uint8_t step, uint32_t flat)
+{
+#if DISPLAY_BPP == 4
+    uint8_t* target = pixels();
+    const uint8_t(*rows[WIDTH / TileAtlas::SIZE])[TileAtlas::ROW_BYTES];
+
+    for(uint8_t i = 0; i < count; i++)
+    {
+        uint8_t left = x + i * step;
+        rows[i] = TILES.rows[colors[i] != flat][ink(colors[i])][left & 1];
+    }
+
+    for(uint8_t row = 0; row < TileAtlas::SIZE; row++)
+    {
+        for(uint8_t i = 0; i < count; i++)
+        {
+            blit_row(target, x + i * step, y + row, rows[i][row]);
+        }
+    }
+#else
+    for(uint8_t i = 0; i < count; i++)
+    {
+        tile(x + i * step, y, colors[i], colors[i] != flat);
+    }
+#endif
+}
@@ -0,0 +1,81 @@
+#include "frame_stats.h"
+#include <stdint.h>
+#include <stdio.h>
+
+
+void Histogram::clear()
+{
+    count = 0;
+    max = 0;
+    sum = 0;
+
+    for(uint8_t i = 0; i < BUCKETS; i++)
+    {
+        buckets[i] = 0;
+    }
+}
+
+
+/*
+ * Upper bound of the bucket that holds the given percentile, max for the last
+ * bucket, 0 without samples.
+ */
+uint32_t Histogram::percentile(uint8_t percent) const
+{
+    uint64_t rank = ((uint64_t)count * percent + 99) / 100;
+    uint32_t seen = 0;
+
+    for(uint8_t i = 0; i < BUCKETS - 1; i++)
+    {
+        seen += buckets[i];
+
+        if(seen >= rank && seen)
+        {
+            return i ? (1u << i) - 1 : 0;
+        }
+    }
+
+    return max;
+}
+
+
+void FrameStats::clear()
+{
+    logic.clear();
+    render.clear();
+    flush.clear();
+    latency.clear();
+    late_ticks = 0;
+    missed_frames = 0;
+    untracked_inputs = 0;
+}
+
+
+/*
+ * Compact text snapshot, one line per histogram with count, mean, p50, p99
+ * and max in microseconds, then the budget counters.
+ * Returns the length without the terminating zero, cut to fit size.
+ */
+uint16_t FrameStats::format(char* text, uint16_t size) const
+{
+    static const char* const NAMES[] = {"logic", "render", "flush", "latency"};
+    const Histogram* histograms[] = {&logic, &render, &flush, &latency};
+    uint16_t length = 0;
+
+    for(uint8_t i = 0; i < 4 && length < size; i++)
+    {
+        const Histogram& h = *histograms[i];
+
+        length += snprintf(text + length, size - length, "%s n %lu mean %lu p50 %lu p99 %lu max %lu us\n", NAMES[i],
+                           (unsigned long)h.count, (unsigned long)(h.count ? h.sum / h.count : 0),
+                           (unsigned long)h.percentile(50), (unsigned long)h.percentile(99), (unsigned long)h.max);
+    }
+
+    if(length < size)
+    {
+        length += snprintf(text + length, size - length, "late ticks %lu missed frames %lu untracked inputs %lu\n",
+                           (unsigned long)late_ticks, (unsigned long)missed_frames, (unsigned long)untracked_inputs);
+    }
+
+    return length < size ? length : (size ? size - 1 : 0);
+}
@@ -0,0 +1,70 @@
+#ifndef FRAME_STATS_H_
+#define FRAME_STATS_H_
+
+#include "game_core.h"
+#include <stdint.h>
+
+
+/**
+* Fixed bucket histogram of durations in microseconds.
+* Bucket 0 counts zeros, bucket k the values from 2^(k-1) up to below 2^k and
+* the last one everything from 2^14 us on, so adding a value is a count of
+* leading zeros and a few increments.
+*/
+class Histogram
+{
+  public:
+    static const uint8_t BUCKETS = 16;
+
+    uint32_t count;
+    uint32_t max;
+    uint64_t sum;
+    uint32_t buckets[BUCKETS];
+
+    Histogram() { clear(); }
+    void clear();
+    uint32_t percentile(uint8_t percent) const;
+
+    void add(uint32_t us)
+    {
+        uint8_t bucket = us ? 32 - __builtin_clz(us) : 0;
+
+        buckets[bucket < BUCKETS ? bucket : BUCKETS - 1]++;
+        count++;
+        sum += us;
+        max = us > max ? us : max;
+    }
+};
+
+
+/**
+* Frame time and input latency of the game driver, cheap enough to always run.
+* The logic side writes logic and late_ticks, the render side the rest. All
+* fields are plain words, a snapshot copied while the game runs can be one
+* frame out of step between them.
+*/
+struct FrameStats
+{
+    // Budget of one frame, 1000 / FRAME_RATE ms.
+    static const uint32_t FRAME_US = 1000000 / GameCore::FRAME_RATE;
+
+    // Per tick, stepping and publishing.
+    Histogram logic;
+    // Per drawn frame, drawing and flushing.
+    Histogram render;
+    // Per drawn frame, only the transfer of its flushed windows.
+    Histogram flush;
+    // Button interrupt to the end of the first flush that shows the press.
+    Histogram latency;
+    // Ticks and drawn frames over the frame budget.
+    uint32_t late_ticks;
+    uint32_t missed_frames;
+    // Presses whose latency was not measured because too many were in flight.
+    uint32_t untracked_inputs;
+
+    FrameStats() { clear(); }
+    void clear();
+    uint16_t format(char* text, uint16_t size) const;
+};
+
+#endif
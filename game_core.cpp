@@ -0,0 +1,573 @@
+#include "game_core.h"
+#include "trace.h"
+#include <cstring>
+#include <stdint.h>
+
+
+GameCore::GameCore() { reset(1, 0); }
+
+
+/*
+ * Starts a new game, the seed fully determines the block sequence.
+ */
+void GameCore::reset(uint32_t seed, uint8_t start_level)
+{
+    this->seed = seed;
+    this->start_level = start_level < MAX_LEVEL ? start_level : MAX_LEVEL;
+    score = 0;
+    level = this->start_level;
+    game_over = false;
+    cleared_lines = 0;
+    frame = 0;
+    gravity_counter = 0;
+    events = 0;
+    last_clear = 0;
+    lock_row = 0;
+    rng_state = seed ? seed : 1;
+    pieces = 0;
+
+    memset(field_rows, 0, sizeof(field_rows));
+    memset(field_colors, 0, sizeof(field_colors));
+    field_hash = 0;
+
+    for(uint8_t i = 0; i < PREVIEW_LENGTH; i++)
+    {
+        preview[i] = Block::Shape(next_random() % 7);
+    }
+
+    spawn_block();
+}
+
+
+/*
+ * Advances the game by exactly one frame.
+ * Inputs are applied before gravity, returns the events of this frame.
+ */
+uint8_t GameCore::step(FrameInputs inputs)
+{
+    events = 0;
+
+    if(game_over)
+    {
+        return events;
+    }
+
+    frame++;
+
+    if(inputs & MOVE_LEFT)
+    {
+        move_block_left();
+    }
+
+    if(inputs & MOVE_RIGHT)
+    {
+        move_block_right();
+    }
+
+    if(inputs & ROTATE_LEFT)
+    {
+        rotate_block(Block::LEFT);
+    }
+
+    if(inputs & ROTATE_RIGHT)
+    {
+        rotate_block(Block::RIGHT);
+    }
+
+    if(++gravity_counter >= GRAVITY.frames[level])
+    {
+        gravity_counter = 0;
+        move_block_downwards();
+    }
+
+    return events;
+}
+
+
+/*
+ * Xorshift32, the only source of randomness of the game.
+ */
+uint32_t GameCore::next_random()
+{
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 17;
+    rng_state ^= rng_state << 5;
+    return rng_state;
+}
+
+
+/*
+ * Creates the next block at the top of the field and refills the preview.
+ */
+void GameCore::spawn_block()
+{
+    block.init(preview[0]);
+    update_block_hash();
+    pieces++;
+
+    for(uint8_t i = 1; i < PREVIEW_LENGTH; i++)
+    {
+        preview[i - 1] = preview[i];
+    }
+
+    preview[PREVIEW_LENGTH - 1] = Block::Shape(next_random() % 7);
+}
+
+
+/*
+ * Finish block after it reached ground.
+ */
+void GameCore::finish_block()
+{
+    TRACE_SPAN(FINISH_BLOCK);
+
+    for(uint8_t i = 0; i < block.SQUARE_NUMBER; i++)
+    {
+        uint8_t x = block.squares[i].x + block.center.x;
+        uint8_t y = block.squares[i].y + block.center.y;
+
+        if(x >= SQUARES_PER_ROW || y >= SQUARES_PER_COLUMN)
+        {
+            continue;
+        }
+
+        field_rows[y] |= 1 << x;
+        field_colors[y][x] = block.color;
+        field_hash ^= ZOBRIST.squares[y][x];
+    }
+
+    events |= LOCKED;
+    lock_row = block.center.y;
+
+    clear_full_lines();
+    spawn_block();
+}
+
+
+/*
+ * Moves active tetris block to the left.
+ */
+void GameCore::move_block_left()
+{
+    if(!fits(block.shape, block.rotation, block.center.x + 1, block.center.y))
+    {
+        return;
+    }
+
+    block.move_left();
+    update_block_hash();
+}
+
+
+/*
+ * Moves active tetris block to the right.
+ */
+void GameCore::move_block_right()
+{
+    if(!fits(block.shape, block.rotation, block.center.x - 1, block.center.y))
+    {
+        return;
+    }
+
+    block.move_right();
+    update_block_hash();
+}
+
+
+/*
+ * Moves active tetris block downwards.
+ */
+void GameCore::move_block_downwards()
+{
+    TRACE_SPAN(MOVE_BLOCK_DOWNWARDS);
+
+    if(block_finished())
+    {
+        finish_block();
+
+        if(game_over)
+        {
+            fill_playfield();
+        }
+
+        return;
+    }
+
+    block.move_down();
+    update_block_hash();
+}
+
+
+/*
+ * Rotates block.
+ */
+void GameCore::rotate_block(Block::Direction d)
+{
+    if(try_rotate(block, d))
+    {
+        update_block_hash();
+    }
+}
+
+
+/*
+ * Checks if a block state lies inside the field without covering a square.
+ * Rows of the piece mask are shifted onto the field rows, no block is built.
+ */
+bool GameCore::fits(Block::Shape shape, uint8_t rotation, int8_t x, int8_t y) const
+{
+    const PieceState& state = Block::PIECES.states[shape][rotation];
+    int8_t left = x + state.left;
+    int8_t top = y + state.top;
+
+    if(left < 0 || left + state.width > SQUARES_PER_ROW || top < 0 || top + state.height > SQUARES_PER_COLUMN)
+    {
+        return false;
+    }
+
+    for(uint8_t row = 0; row < state.height; row++)
+    {
+        if(field_rows[top + row] & (((state.mask >> (row * 4)) & 0xF) << left))
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+
+/*
+ * Index of the first SRS kick test that fits after turning a block state,
+ * -1 if the turn is blocked.
+ */
+int8_t GameCore::rotation_kick(Block::Shape shape, uint8_t rotation, Block::Direction d, int8_t x, int8_t y) const
+{
+    const Cell* kicks = Block::PIECES.kicks[shape][rotation][d];
+    uint8_t turned = Block::turn(shape, rotation, d);
+
+    for(uint8_t k = 0; k < PieceTable::KICK_TESTS; k++)
+    {
+        if(fits(shape, turned, x + kicks[k].x, y + kicks[k].y))
+        {
+            return k;
+        }
+    }
+
+    return -1;
+}
+
+
+/*
+ * Turns a block with SRS wall kicks, the first kick test that fits wins.
+ * Returns false and leaves the block alone if none fits.
+ */
+bool GameCore::try_rotate(Block& b, Block::Direction d) const
+{
+    int8_t k = rotation_kick(b.shape, b.rotation, d, b.center.x, b.center.y);
+
+    if(k < 0)
+    {
+        return false;
+    }
+
+    const Cell& kick = Block::PIECES.kicks[b.shape][b.rotation][d][k];
+
+    b.rotate(d);
+    b.center.x += kick.x;
+    b.center.y += kick.y;
+    return true;
+}
+
+
+/*
+ * Adds points for cleared lines and raises the level every ten lines.
+ */
+void GameCore::update_score(uint8_t full_lines)
+{
+    score += line_points(full_lines, level);
+    cleared_lines += full_lines;
+    last_clear = full_lines;
+    events |= LINES_CLEARED;
+
+    if(levels_up(cleared_lines, level))
+    {
+        level++;
+        events |= LEVEL_UP;
+    }
+}
+
+
+/*
+ * Points for clearing full_lines at once on a level.
+ */
+uint32_t GameCore::line_points(uint8_t full_lines, uint8_t level)
+{
+    switch(full_lines)
+    {
+        case 1:
+            return ONE_LINE_POINTS * (level + 1);
+        case 2:
+            return TWO_LINES_POINTS * (level + 1);
+        case 3:
+            return THREE_LINES_POINTS * (level + 1);
+        case 4:
+            return FOUR_LINES_POINTS * (level + 1);
+    }
+
+    return 0;
+}
+
+
+/*
+ * Checks if a clear that brought the line count to cleared_lines raises the level.
+ */
+bool GameCore::levels_up(uint16_t cleared_lines, uint8_t level)
+{
+    return cleared_lines >= (level + 1) * 10 && level < MAX_LEVEL;
+}
+
+
+/*
+ * Clears lines filled by user.
+ * Remaining rows are compacted downwards in a single bottom up pass.
+ */
+void GameCore::clear_full_lines()
+{
+    TRACE_SPAN(CLEAR_FULL_LINES);
+
+    uint8_t full_lines = 0;
+
+    for(int8_t y = SQUARES_PER_COLUMN - 1; y >= 0; y--)
+    {
+        if(field_rows[y] == FULL_ROW)
+        {
+            field_hash ^= row_hash(y, FULL_ROW);
+            full_lines++;
+            continue;
+        }
+
+        // Rows below were removed or moved already, so the target slot is
+        // no longer part of the hash.
+        if(full_lines)
+        {
+            field_hash ^= row_hash(y, field_rows[y]) ^ row_hash(y + full_lines, field_rows[y]);
+            field_rows[y + full_lines] = field_rows[y];
+            memcpy(field_colors[y + full_lines], field_colors[y], sizeof(field_colors[y]));
+        }
+    }
+
+    if(!full_lines)
+    {
+        return;
+    }
+
+    memset(field_rows, 0, full_lines * sizeof(field_rows[0]));
+    update_score(full_lines);
+}
+
+
+/*
+ * Checks if the active block has reached any ground and is finished.
+ */
+bool GameCore::block_finished()
+{
+    if(!grounded(block.shape, block.rotation, block.center.x, block.center.y))
+    {
+        return false;
+    }
+
+    if(tops_out(block.center.y))
+    {
+        game_over = true;
+        events |= GAME_OVER;
+    }
+
+    return true;
+}
+
+/*
+ * Checks if a fitting block state rests on the field bottom or on another block.
+ */
+bool GameCore::grounded(Block::Shape shape, uint8_t rotation, int8_t x, int8_t y) const
+{
+    return !fits(shape, rotation, x, y + 1);
+}
+
+
+/**
+ * Fills the whole playfield with blocks.
+ */
+void GameCore::fill_playfield()
+{
+    for(uint8_t y = 0; y < SQUARES_PER_COLUMN; y++)
+    {
+        field_rows[y] = FULL_ROW;
+
+        for(uint8_t x = 0; x < SQUARES_PER_ROW; x++)
+        {
+            field_colors[y][x] = TFT_SKYBLUE;
+        }
+    }
+
+    update_field_hash();
+}
+
+
+/*
+ * Zobrist hash of the occupied squares of one row.
+ */
+uint64_t GameCore::row_hash(uint8_t y, uint16_t row) const
+{
+    uint64_t h = 0;
+
+    for(uint8_t x = 0; row; x++, row >>= 1)
+    {
+        if(row & 1)
+        {
+            h ^= ZOBRIST.squares[y][x];
+        }
+    }
+
+    return h;
+}
+
+
+/*
+ * Recomputes the field hash, for callers that write field_rows directly.
+ */
+void GameCore::update_field_hash()
+{
+    field_hash = 0;
+
+    for(uint8_t y = 0; y < SQUARES_PER_COLUMN; y++)
+    {
+        field_hash ^= row_hash(y, field_rows[y]);
+    }
+}
+
+
+/*
+ * Hash of the active block from shape, rotation and center.
+ */
+void GameCore::update_block_hash()
+{
+    block_hash = ZOBRIST.blocks[block.shape][block.rotation] ^
+                 ZOBRIST.centers_x[(uint8_t)(block.center.x + ZobristKeys::OFFSET) % ZobristKeys::CENTERS_X] ^
+                 ZOBRIST.centers_y[(uint8_t)(block.center.y + ZobristKeys::OFFSET) % ZobristKeys::CENTERS_Y];
+}
+
+
+
+Block::Block() {}
+
+
+Block::Block(const Block& b)
+{
+    color = b.color;
+    center.x = b.center.x;
+    center.y = b.center.y;
+    shape = b.shape;
+    rotation = b.rotation;
+
+
+    for(uint8_t i = 0; i < b.SQUARE_NUMBER; i++)
+    {
+        squares[i].x = b.squares[i].x;
+        squares[i].y = b.squares[i].y;
+        squares[i].color = b.squares[i].color;
+    }
+}
+
+/*
+ * Creates a new block of the given shape at the spawn position.
+ */
+void Block::init(Shape shape)
+{
+    center.x = 4;
+    center.y = 0;
+
+    this->shape = shape;
+    set_state(0);
+
+    color = get_color();
+    squares[0].color = color;
+    squares[1].color = color;
+    squares[2].color = color;
+    squares[3].color = color;
+}
+
+
+/*
+ * Get block color.
+ */
+uint32_t Block::get_color()
+{
+    switch(shape)
+    {
+        case L:
+            return TFT_RED;
+        case J:
+            return TFT_BLUE;
+        case S:
+            return TFT_GREEN;
+        case Z:
+            return TFT_YELLOW;
+        case O:
+            return TFT_CYAN;
+        case I:
+            return TFT_ORANGE;
+        case T:
+            return TFT_PURPLE;
+    }
+
+    return TFT_RED;
+}
+
+
+/*
+ * Square offsets of a rotation state from the piece table.
+ */
+void Block::set_state(uint8_t rotation)
+{
+    const PieceState& state = PIECES.states[shape][rotation];
+
+    this->rotation = rotation;
+
+    for(uint8_t i = 0; i < SQUARE_NUMBER; i++)
+    {
+        squares[i].x = state.cells[i].x;
+        squares[i].y = state.cells[i].y;
+    }
+}
+
+
+/*
+ * Rotation state after a quarter turn, O keeps its state.
+ */
+uint8_t Block::turn(Shape shape, uint8_t rotation, Direction d)
+{
+    return shape == O ? rotation : (rotation + (d == RIGHT ? 1 : 3)) & 3;
+}
+
+
+/*
+ * 90° block rotation in place, wall kicks are up to GameCore::try_rotate.
+ */
+void Block::rotate(Direction d) { set_state(turn(shape, rotation, d)); }
+
+void Block::move_left() { center.x++; }
+void Block::move_right() { center.x--; }
+void Block::move_down() { center.y++; }
+
+
+/*
+ * Set square values.
+ */
+void Square::init(int8_t x, int8_t y, uint32_t color, bool filled)
+{
+    this->x = x;
+    this->y = y;
+    this->color = color;
+    this->filled = filled;
+}
@@ -0,0 +1,424 @@
+#ifndef GAME_CORE_H_
+#define GAME_CORE_H_
+
+#include "colors.h"
+#include <stdint.h>
+
+
+/**
+* Tetris square part of block.
+*/
+class Square
+{
+  public:
+    int8_t x;
+    int8_t y;
+    uint32_t color;
+    bool filled;
+
+    void init(int8_t x, int8_t y, uint32_t color, bool filled);
+};
+
+/**
+* Square offset from a block center.
+*/
+struct Cell
+{
+    int8_t x;
+    int8_t y;
+};
+
+
+/**
+* One rotation state of a shape, as cell offsets and as a 4x4 occupancy mask.
+* Bit (row * 4 + column) of the mask is the square at (left + column, top + row),
+* width and height are the extents of the occupied squares.
+*/
+struct PieceState
+{
+    Cell cells[4];
+    uint16_t mask;
+    int8_t left;
+    int8_t top;
+    uint8_t width;
+    uint8_t height;
+};
+
+
+/**
+* Rotation states and SRS wall kicks of all shapes, generated at compile time.
+* State 0 is the spawn orientation, a right turn goes to the next state. J, L,
+* S, T and Z turn about the center of their 3x3 box, I about the center of its
+* 4x4 box and O does not turn. All offsets are in field coordinates, x to the
+* right and y down. J, L, S, T and Z spawn flat side up, which is SRS state 2.
+*/
+class PieceTable
+{
+  public:
+    static const uint8_t SHAPES = 7;
+    static const uint8_t STATES = 4;
+    static const uint8_t KICK_TESTS = 5;
+
+    // Spawn cells and the doubled rotation pivot per shape, in Block::Shape order.
+    static constexpr Cell SPAWN[SHAPES][4] = {
+        {{-1, 0}, {0, 0}, {1, 0}, {1, 1}},  // L
+        {{-1, 1}, {-1, 0}, {0, 0}, {1, 0}}, // J
+        {{1, 1}, {0, 1}, {0, 0}, {-1, 0}},  // S
+        {{-1, 1}, {0, 1}, {0, 0}, {1, 0}},  // Z
+        {{-1, 0}, {0, 0}, {-1, -1}, {0, -1}}, // O
+        {{-2, 1}, {-1, 1}, {0, 1}, {1, 1}}, // I
+        {{-1, 0}, {0, 0}, {0, 1}, {1, 0}}   // T
+    };
+    static constexpr Cell PIVOT2[SHAPES] = {{0, 0}, {0, 0}, {0, 0}, {0, 0}, {-1, -1}, {-1, 3}, {0, 0}};
+
+    /*
+    * SRS kick tests per start state, for a left [0] and a right [1] turn.
+    * The published tables have y pointing up, here it is flipped.
+    */
+    static constexpr Cell KICKS_JLSTZ[STATES][2][KICK_TESTS] = {
+        {{{0, 0}, {1, 0}, {1, -1}, {0, 2}, {1, 2}}, {{0, 0}, {-1, 0}, {-1, -1}, {0, 2}, {-1, 2}}},
+        {{{0, 0}, {1, 0}, {1, 1}, {0, -2}, {1, -2}}, {{0, 0}, {1, 0}, {1, 1}, {0, -2}, {1, -2}}},
+        {{{0, 0}, {-1, 0}, {-1, -1}, {0, 2}, {-1, 2}}, {{0, 0}, {1, 0}, {1, -1}, {0, 2}, {1, 2}}},
+        {{{0, 0}, {-1, 0}, {-1, 1}, {0, -2}, {-1, -2}}, {{0, 0}, {-1, 0}, {-1, 1}, {0, -2}, {-1, -2}}}
+    };
+    static constexpr Cell KICKS_I[STATES][2][KICK_TESTS] = {
+        {{{0, 0}, {-1, 0}, {2, 0}, {-1, -2}, {2, 1}}, {{0, 0}, {-2, 0}, {1, 0}, {-2, 1}, {1, -2}}},
+        {{{0, 0}, {2, 0}, {-1, 0}, {2, -1}, {-1, 2}}, {{0, 0}, {-1, 0}, {2, 0}, {-1, -2}, {2, 1}}},
+        {{{0, 0}, {1, 0}, {-2, 0}, {1, 2}, {-2, -1}}, {{0, 0}, {2, 0}, {-1, 0}, {2, -1}, {-1, 2}}},
+        {{{0, 0}, {-2, 0}, {1, 0}, {-2, 1}, {1, -2}}, {{0, 0}, {1, 0}, {-2, 0}, {1, 2}, {-2, -1}}}
+    };
+
+    PieceState states[SHAPES][STATES];
+    // Kick tests per shape, start state and turn direction, O only tests in place.
+    Cell kicks[SHAPES][STATES][2][KICK_TESTS];
+
+    constexpr PieceTable() : states(), kicks()
+    {
+        for(uint8_t shape = 0; shape < SHAPES; shape++)
+        {
+            for(uint8_t i = 0; i < 4; i++)
+            {
+                states[shape][0].cells[i] = SPAWN[shape][i];
+            }
+
+            for(uint8_t state = 1; state < STATES; state++)
+            {
+                for(uint8_t i = 0; i < 4; i++)
+                {
+                    Cell c = states[shape][state - 1].cells[i];
+                    Cell p = PIVOT2[shape];
+
+                    // Quarter turn right about the pivot, the O box maps onto itself.
+                    states[shape][state].cells[i] = {(int8_t)((p.x + p.y - 2 * c.y) / 2),
+                                                     (int8_t)((p.y - p.x + 2 * c.x) / 2)};
+                }
+            }
+
+            for(uint8_t state = 0; state < STATES; state++)
+            {
+                PieceState& s = states[shape][state];
+
+                s.left = s.cells[0].x;
+                s.top = s.cells[0].y;
+                s.mask = 0;
+                s.width = 1;
+                s.height = 1;
+
+                for(uint8_t i = 1; i < 4; i++)
+                {
+                    s.left = s.cells[i].x < s.left ? s.cells[i].x : s.left;
+                    s.top = s.cells[i].y < s.top ? s.cells[i].y : s.top;
+                }
+
+                for(uint8_t i = 0; i < 4; i++)
+                {
+                    uint8_t column = s.cells[i].x - s.left;
+                    uint8_t row = s.cells[i].y - s.top;
+
+                    s.mask |= 1 << (row * 4 + column);
+                    s.width = column >= s.width ? column + 1 : s.width;
+                    s.height = row >= s.height ? row + 1 : s.height;
+                }
+
+                for(uint8_t d = 0; d < 2; d++)
+                {
+                    for(uint8_t k = 0; k < KICK_TESTS; k++)
+                    {
+                        kicks[shape][state][d][k] = shape == 5   ? KICKS_I[state][d][k]
+                                                    : shape == 4 ? Cell{0, 0}
+                                                                 : KICKS_JLSTZ[(state + 2) & 3][d][k];
+                    }
+                }
+            }
+        }
+    }
+};
+
+
+/**
+* Tetris block.
+*/
+class Block
+{
+  public:
+    static const uint8_t SQUARE_NUMBER = 4;
+    static constexpr PieceTable PIECES = PieceTable();
+
+    enum Shape
+    {
+        L,
+        J,
+        S,
+        Z,
+        O,
+        I,
+        T
+    };
+
+    enum Direction
+    {
+        LEFT,
+        RIGHT
+    };
+
+
+    Shape shape;
+    // Quarter turns to the right since init, modulo 4.
+    uint8_t rotation;
+
+    uint32_t color;
+    Square squares[SQUARE_NUMBER];
+    Square center;
+
+    Block();
+    Block(const Block& b);
+    void init(Shape shape);
+    uint32_t get_color();
+    void set_state(uint8_t rotation);
+    static uint8_t turn(Shape shape, uint8_t rotation, Direction d);
+    void rotate(Direction d);
+    void move_left();
+    void move_right();
+    void move_down();
+};
+
+
+/**
+* Frames per row of gravity for every level, generated at compile time.
+*/
+class GravityTable
+{
+  public:
+    static const uint8_t LEVELS = 30;
+
+    uint8_t frames[LEVELS];
+
+    /*
+    * Classic curve, levels 29 and above drop one row per frame.
+    */
+    static constexpr uint8_t frames_per_row(uint8_t level)
+    {
+        return level < 5    ? 48 - 5 * level
+               : level == 5 ? 18
+               : level == 6 ? 13
+               : level == 7 ? 8
+               : level == 8 ? 6
+               : level < 13 ? 5
+               : level < 16 ? 4
+               : level < 19 ? 3
+               : level < 29 ? 2
+                            : 1;
+    }
+
+    constexpr GravityTable() : frames()
+    {
+        for(uint8_t level = 0; level < LEVELS; level++)
+        {
+            frames[level] = frames_per_row(level);
+        }
+    }
+};
+
+
+/**
+* Zobrist keys for field squares and block states, generated at compile time
+* with splitmix64.
+*/
+class ZobristKeys
+{
+  public:
+    static const uint8_t COLUMNS = 10;
+    static const uint8_t ROWS = 13;
+    // Block centers are offset so every reachable position has a key.
+    static const uint8_t OFFSET = 3;
+    static const uint8_t CENTERS_X = 16;
+    static const uint8_t CENTERS_Y = 18;
+
+    uint64_t squares[ROWS][COLUMNS];
+    uint64_t blocks[7][4];
+    uint64_t centers_x[CENTERS_X];
+    uint64_t centers_y[CENTERS_Y];
+
+    static constexpr uint64_t splitmix64(uint64_t& state)
+    {
+        uint64_t z = (state += 0x9E3779B97F4A7C15ull);
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+        return z ^ (z >> 31);
+    }
+
+    constexpr ZobristKeys() : squares(), blocks(), centers_x(), centers_y()
+    {
+        uint64_t state = 0x7E7215;
+
+        for(uint8_t y = 0; y < ROWS; y++)
+        {
+            for(uint8_t x = 0; x < COLUMNS; x++)
+            {
+                squares[y][x] = splitmix64(state);
+            }
+        }
+
+        for(uint8_t shape = 0; shape < 7; shape++)
+        {
+            for(uint8_t rotation = 0; rotation < 4; rotation++)
+            {
+                blocks[shape][rotation] = splitmix64(state);
+            }
+        }
+
+        for(uint8_t x = 0; x < CENTERS_X; x++)
+        {
+            centers_x[x] = splitmix64(state);
+        }
+
+        for(uint8_t y = 0; y < CENTERS_Y; y++)
+        {
+            centers_y[y] = splitmix64(state);
+        }
+    }
+};
+
+
+/**
+* Buttons pressed during one frame, bitmask of GameCore::Input.
+*/
+typedef uint8_t FrameInputs;
+
+
+/**
+* Game rules without any hardware access.
+* The state only changes in step(), which advances exactly one frame, so a
+* seed and the input of every frame reproduce a game exactly.
+*/
+class GameCore
+{
+  public:
+    // Playfield size in squares.
+    static const uint8_t SQUARES_PER_COLUMN = 13;
+    static const uint8_t SQUARES_PER_ROW = 10;
+    static const uint16_t FULL_ROW = (1 << SQUARES_PER_ROW) - 1;
+
+    // Simulation rate.
+    static const uint8_t FRAME_RATE = 60;
+    static const uint8_t MAX_LEVEL = GravityTable::LEVELS - 1;
+    static const uint8_t PREVIEW_LENGTH = 3;
+    static constexpr GravityTable GRAVITY = GravityTable();
+    static constexpr ZobristKeys ZOBRIST = ZobristKeys();
+
+    // Score data.
+    static const uint16_t ONE_LINE_POINTS = 40;
+    static const uint16_t TWO_LINES_POINTS = 100;
+    static const uint16_t THREE_LINES_POINTS = 300;
+    static const uint16_t FOUR_LINES_POINTS = 1200;
+
+    enum Input : uint8_t
+    {
+        MOVE_LEFT = 1 << 0,
+        MOVE_RIGHT = 1 << 1,
+        ROTATE_LEFT = 1 << 2,
+        ROTATE_RIGHT = 1 << 3
+    };
+
+    enum Event : uint8_t
+    {
+        LOCKED = 1 << 0,
+        LINES_CLEARED = 1 << 1,
+        LEVEL_UP = 1 << 2,
+        GAME_OVER = 1 << 3
+    };
+
+    // Seed and level the game was started with.
+    uint32_t seed;
+    uint8_t start_level;
+    // User score from cleared lines.
+    uint32_t score;
+    // Current block speed level.
+    uint8_t level;
+    // Game over flag.
+    bool game_over;
+    // Number of overall cleared lines.
+    uint16_t cleared_lines;
+    // Frames simulated since reset.
+    uint32_t frame;
+    // Frames since the last gravity step.
+    uint8_t gravity_counter;
+    // Events raised by the current step.
+    uint8_t events;
+    // Lines of the clear that raised LINES_CLEARED.
+    uint8_t last_clear;
+    // Center row of the last locked block.
+    int8_t lock_row;
+    // Block sequence generator state.
+    uint32_t rng_state;
+    // Upcoming shapes, preview[0] spawns next.
+    Block::Shape preview[PREVIEW_LENGTH];
+    // Blocks spawned since reset.
+    uint32_t pieces;
+    // Zobrist hashes of the field squares and of the active block state.
+    uint64_t field_hash;
+    uint64_t block_hash;
+
+    // Playfield occupancy, one bit per column for each row.
+    uint16_t field_rows[SQUARES_PER_COLUMN];
+    // Playfield square colors, only valid where the occupancy bit is set.
+    uint16_t field_colors[SQUARES_PER_COLUMN][SQUARES_PER_ROW];
+
+    // Currently active block.
+    Block block;
+
+
+    GameCore();
+    void reset(uint32_t seed, uint8_t start_level);
+    uint8_t step(FrameInputs inputs);
+
+    uint64_t hash() const { return field_hash ^ block_hash; }
+    // Steps until gravity moves the block, counting the step that does.
+    uint8_t frames_until_gravity() const { return GRAVITY.frames[level] - gravity_counter; }
+    uint64_t row_hash(uint8_t y, uint16_t row) const;
+    void update_field_hash();
+    void update_block_hash();
+
+    uint32_t next_random();
+    void spawn_block();
+    void move_block_left();
+    void move_block_right();
+    void move_block_downwards();
+    void rotate_block(Block::Direction d);
+    bool fits(Block::Shape shape, uint8_t rotation, int8_t x, int8_t y) const;
+    int8_t rotation_kick(Block::Shape shape, uint8_t rotation, Block::Direction d, int8_t x, int8_t y) const;
+    bool try_rotate(Block& b, Block::Direction d) const;
+    void update_score(uint8_t full_lines);
+    static uint32_t line_points(uint8_t full_lines, uint8_t level);
+    static bool levels_up(uint16_t cleared_lines, uint8_t level);
+    // Locking with the center in the spawn row ends the game, so does locking
+    // above it where an upward kick lifted the block.
+    static bool tops_out(int8_t center_y) { return center_y <= 0; }
+    void finish_block();
+    void clear_full_lines();
+    bool block_finished();
+    bool grounded(Block::Shape shape, uint8_t rotation, int8_t x, int8_t y) const;
+    void fill_playfield();
+};
+
+#endif
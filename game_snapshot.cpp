@@ -0,0 +1,192 @@
+#include "game_snapshot.h"
+#include <stdint.h>
+
+
+// Bytes save() writes per field, the fields must fit them and add up to SIZE.
+static const uint8_t HEADER_BYTES = 1 + 4 + 1 + 4 + 1 + 1 + 2 + 4 + 1 + 1 + 4;
+static const uint8_t BLOCK_BYTES = GameCore::PREVIEW_LENGTH + 4 + 1 + 1 + 1 + 1 + 8 + 8;
+static const uint8_t FIELD_BYTES = GameCore::SQUARES_PER_COLUMN * 2 + GameCore::SQUARES_PER_COLUMN * GameCore::SQUARES_PER_ROW / 2;
+
+static_assert(sizeof(GameCore::seed) <= 4 && sizeof(GameCore::score) <= 4 && sizeof(GameCore::frame) <= 4 &&
+                  sizeof(GameCore::rng_state) <= 4 && sizeof(GameCore::pieces) <= 4,
+              "32 bit counter fields");
+static_assert(sizeof(GameCore::cleared_lines) <= 2 && sizeof(GameCore::field_rows[0]) <= 2, "16 bit fields");
+static_assert(sizeof(GameCore::field_hash) <= 8 && sizeof(GameCore::block_hash) <= 8, "hash fields");
+static_assert(GameCore::SQUARES_PER_COLUMN * GameCore::SQUARES_PER_ROW % 2 == 0, "colors are packed in pairs");
+static_assert(HEADER_BYTES + BLOCK_BYTES + FIELD_BYTES + 4 == GameSnapshot::SIZE, "SIZE matches the saved fields");
+
+
+static void put(uint8_t*& out, uint64_t value, uint8_t bytes)
+{
+    for(uint8_t i = 0; i < bytes; i++)
+    {
+        *out++ = value >> (8 * i);
+    }
+}
+
+
+static uint64_t get(const uint8_t*& in, uint8_t bytes)
+{
+    uint64_t value = 0;
+
+    for(uint8_t i = 0; i < bytes; i++)
+    {
+        value |= (uint64_t)*in++ << (8 * i);
+    }
+
+    return value;
+}
+
+
+/*
+ * Color code of a square, colors outside the table become code 0.
+ */
+static uint8_t color_code(uint16_t color)
+{
+    uint8_t code = 0;
+
+    for(uint8_t i = 1; i < 8; i++)
+    {
+        code = color == GameSnapshot::COLORS[i] ? i : code;
+    }
+
+    return code;
+}
+
+
+/*
+ * Writes SIZE bytes. Colors of empty squares are not kept, they come back
+ * as code 0 like any color outside the table.
+ */
+void GameSnapshot::save(const GameCore& core, uint8_t* out)
+{
+    uint8_t* p = out;
+
+    put(p, VERSION, 1);
+    put(p, core.seed, 4);
+    put(p, core.start_level, 1);
+    put(p, core.score, 4);
+    put(p, core.level, 1);
+    put(p, core.game_over, 1);
+    put(p, core.cleared_lines, 2);
+    put(p, core.frame, 4);
+    put(p, core.gravity_counter, 1);
+    put(p, (uint8_t)core.lock_row, 1);
+    put(p, core.rng_state, 4);
+
+    for(uint8_t i = 0; i < GameCore::PREVIEW_LENGTH; i++)
+    {
+        put(p, core.preview[i], 1);
+    }
+
+    put(p, core.pieces, 4);
+    put(p, core.block.shape, 1);
+    put(p, core.block.rotation, 1);
+    put(p, (uint8_t)core.block.center.x, 1);
+    put(p, (uint8_t)core.block.center.y, 1);
+    put(p, core.field_hash, 8);
+    put(p, core.block_hash, 8);
+
+    for(uint8_t y = 0; y < GameCore::SQUARES_PER_COLUMN; y++)
+    {
+        put(p, core.field_rows[y], 2);
+    }
+
+    const uint16_t* colors = &core.field_colors[0][0];
+    const uint16_t* rows = core.field_rows;
+
+    for(uint8_t i = 0; i < GameCore::SQUARES_PER_COLUMN * GameCore::SQUARES_PER_ROW; i += 2)
+    {
+        uint8_t y = i / GameCore::SQUARES_PER_ROW;
+        uint8_t x = i % GameCore::SQUARES_PER_ROW;
+        uint8_t high = (rows[y] >> x & 1) ? color_code(colors[i]) : 0;
+        uint8_t low = (rows[y] >> (x + 1) & 1) ? color_code(colors[i + 1]) : 0;
+
+        put(p, high << 4 | low, 1);
+    }
+
+    put(p, checksum(out), 4);
+}
+
+
+/*
+ * Overwrites the whole state of core, the blob is not checked.
+ */
+void GameSnapshot::restore(const uint8_t* in, GameCore& core)
+{
+    const uint8_t* p = in + 1;
+
+    core.seed = get(p, 4);
+    core.start_level = get(p, 1);
+    core.score = get(p, 4);
+    core.level = get(p, 1);
+    core.game_over = get(p, 1);
+    core.cleared_lines = get(p, 2);
+    core.frame = get(p, 4);
+    core.gravity_counter = get(p, 1);
+    core.lock_row = (int8_t)get(p, 1);
+    core.rng_state = get(p, 4);
+
+    for(uint8_t i = 0; i < GameCore::PREVIEW_LENGTH; i++)
+    {
+        core.preview[i] = Block::Shape(get(p, 1));
+    }
+
+    core.pieces = get(p, 4);
+    core.events = 0;
+
+    Block& block = core.block;
+    block.shape = Block::Shape(get(p, 1));
+    block.set_state(get(p, 1));
+    block.center.x = (int8_t)get(p, 1);
+    block.center.y = (int8_t)get(p, 1);
+    block.color = COLORS[block.shape];
+
+    for(uint8_t i = 0; i < Block::SQUARE_NUMBER; i++)
+    {
+        block.squares[i].color = block.color;
+    }
+
+    core.field_hash = get(p, 8);
+    core.block_hash = get(p, 8);
+
+    for(uint8_t y = 0; y < GameCore::SQUARES_PER_COLUMN; y++)
+    {
+        core.field_rows[y] = get(p, 2);
+    }
+
+    uint16_t* colors = &core.field_colors[0][0];
+
+    for(uint8_t i = 0; i < GameCore::SQUARES_PER_COLUMN * GameCore::SQUARES_PER_ROW; i += 2, p++)
+    {
+        colors[i] = COLORS[*p >> 4 & 7];
+        colors[i + 1] = COLORS[*p & 7];
+    }
+}
+
+
+/*
+ * True for a blob of this version with an intact checksum.
+ */
+bool GameSnapshot::valid(const uint8_t* in)
+{
+    const uint8_t* p = in + SIZE - 4;
+
+    return in[0] == VERSION && get(p, 4) == checksum(in);
+}
+
+
+/*
+ * FNV-1a over all bytes before the checksum.
+ */
+uint32_t GameSnapshot::checksum(const uint8_t* data)
+{
+    uint32_t hash = 2166136261u;
+
+    for(uint8_t i = 0; i < SIZE - 4; i++)
+    {
+        hash = (hash ^ data[i]) * 16777619u;
+    }
+
+    return hash;
+}
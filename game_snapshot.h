@@ -0,0 +1,35 @@
+#ifndef GAME_SNAPSHOT_H_
+#define GAME_SNAPSHOT_H_
+
+#include "game_core.h"
+#include <stdint.h>
+
+
+/**
+* Complete game state as a fixed size binary blob, little endian.
+* Version, seed and start level, score, level, game over, cleared lines,
+* frame, gravity counter, lock row, generator state, preview, pieces, active
+* block, both hashes, occupancy rows, square colors as 4 bit codes and an
+* FNV-1a checksum over everything before it.
+*
+* save() and restore() neither allocate nor search, restore() only unpacks
+* and is cheap enough for rollouts. valid() guards blobs from storage.
+*/
+class GameSnapshot
+{
+  public:
+    static const uint8_t VERSION = 1;
+    static const uint8_t SIZE = 146;
+    // Square colors by code, the block colors in shape order and the game over fill.
+    static constexpr uint16_t COLORS[8] = {TFT_RED,  TFT_BLUE,   TFT_GREEN,  TFT_YELLOW,
+                                           TFT_CYAN, TFT_ORANGE, TFT_PURPLE, TFT_SKYBLUE};
+
+    static void save(const GameCore& core, uint8_t* out);
+    static void restore(const uint8_t* in, GameCore& core);
+    static bool valid(const uint8_t* in);
+
+  private:
+    static uint32_t checksum(const uint8_t* data);
+};
+
+#endif
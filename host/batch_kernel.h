@@ -0,0 +1,98 @@
+#ifndef BATCH_KERNEL_H_
+#define BATCH_KERNEL_H_
+
+#include "batch_sim.h"
+#include <stdint.h>
+
+
+/**
+* Drop, lock, full row detection and compaction for WIDTH boards at a time.
+* V wraps one instruction set: a vector of 16 bit lanes with load, store,
+* bitwise ops, lane wise add, sub and compare, and a test for any set lane.
+* Compare results are all ones per lane, so they double as masks.
+*/
+template <typename V> void batch_kernel(BatchSim& sim)
+{
+    const uint32_t n = sim.boards;
+    uint16_t* rows = sim.rows.data();
+    const uint16_t* piece = sim.piece.data();
+    const typename V::T zero = V::set1(0);
+    const typename V::T one = V::set1(1);
+    const typename V::T full = V::set1(GameCore::FULL_ROW);
+
+    for(uint32_t i = 0; i < n; i += V::WIDTH)
+    {
+        typename V::T p[4];
+        typename V::T r[BatchSim::PADDED_ROWS];
+
+        for(uint8_t k = 0; k < 4; k++)
+        {
+            p[k] = V::load(piece + k * n + i);
+        }
+
+        for(uint8_t y = 0; y < BatchSim::PADDED_ROWS; y++)
+        {
+            r[y] = V::load(rows + y * n + i);
+        }
+
+        // Top rows the piece passes before the first collision, the padding always collides.
+        typename V::T blocked = zero;
+        typename V::T drop = zero;
+
+        for(uint8_t t = 0; t <= BatchSim::ROWS; t++)
+        {
+            typename V::T hit = V::or_(V::or_(V::and_(r[t], p[0]), V::and_(r[t + 1], p[1])),
+                                       V::or_(V::and_(r[t + 2], p[2]), V::and_(r[t + 3], p[3])));
+
+            blocked = V::or_(blocked, V::andnot(V::eq(hit, zero), V::set1(0xFFFF)));
+            drop = V::add(drop, V::andnot(blocked, one));
+        }
+
+        V::store(sim.depth.data() + i, drop);
+
+        // Piece row y - (drop - 1) goes into row y, boards that could not drop are reset anyway.
+        for(uint8_t y = 0; y < BatchSim::ROWS; y++)
+        {
+            typename V::T offset = V::sub(V::set1(y + 1), drop);
+            typename V::T add = zero;
+
+            for(uint8_t k = 0; k < 4; k++)
+            {
+                add = V::or_(add, V::and_(V::eq(offset, V::set1(k)), p[k]));
+            }
+
+            r[y] = V::or_(r[y], add);
+        }
+
+        // Top down, a full row pulls everything above it one row down.
+        typename V::T lines = zero;
+
+        for(uint8_t y = 0; y < BatchSim::ROWS; y++)
+        {
+            typename V::T f = V::eq(r[y], full);
+
+            if(!V::any(f))
+            {
+                continue;
+            }
+
+            lines = V::sub(lines, f);
+
+            for(uint8_t k = y; k > 0; k--)
+            {
+                r[k] = V::or_(V::and_(f, r[k - 1]), V::andnot(f, r[k]));
+            }
+
+            r[0] = V::andnot(f, r[0]);
+        }
+
+        V::store(sim.cleared.data() + i, lines);
+
+        for(uint8_t y = 0; y < BatchSim::ROWS; y++)
+        {
+            V::store(rows + y * n + i, r[y]);
+        }
+    }
+}
+
+#endif
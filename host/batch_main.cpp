@@ -0,0 +1,181 @@
+#include "batch_sim.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+
+/*
+* Locks the placement the batch just made into a GameCore and compares the
+* two boards and whether the game ended, returns false on the first
+* difference.
+*/
+static bool verify_step(const BatchSim& sim, std::vector<GameCore>& cores, const std::vector<uint8_t>& shapes)
+{
+    uint32_t n = sim.boards;
+
+    for(uint32_t board = 0; board < n; board++)
+    {
+        GameCore& core = cores[board];
+        const PieceState& state = Block::PIECES.states[shapes[board]][sim.rotation[board]];
+
+        core.block.set_state(sim.rotation[board]);
+        core.block.center.x = sim.column[board] - state.left;
+        core.block.center.y = sim.depth[board] - 1 - state.top;
+
+        // GameCore decides on its own whether the lock ends the game.
+        bool over = core.block_finished() && core.game_over;
+
+        if(over != (bool)sim.topped_out[board])
+        {
+            printf("board %u %s GameCore after %llu placements\n", board,
+                   over ? "tops out only in" : "tops out unlike", (unsigned long long)sim.placements);
+            return false;
+        }
+
+        if(over)
+        {
+            core.reset(sim.seed[board], sim.start_level);
+        }
+        else
+        {
+            core.finish_block();
+        }
+
+        bool same = core.block.shape == sim.shape[board] && core.score == sim.score[board] &&
+                    core.cleared_lines == sim.lines[board] && core.level == sim.level[board];
+
+        for(uint8_t y = 0; y < BatchSim::ROWS; y++)
+        {
+            same = same && core.field_rows[y] == sim.rows[y * n + board];
+        }
+
+        if(!same)
+        {
+            printf("board %u differs from GameCore after %llu placements\n", board,
+                   (unsigned long long)sim.placements);
+            return false;
+        }
+    }
+
+    return true;
+}
+
+
+/*
+* Plays random placements on many boards at once and reports throughput.
+* --verify mirrors every board with a GameCore and compares after each step.
+*
+* usage: tetris_batch [--boards N] [--steps N] [--seed N] [--level N] [--kernel scalar|sse2|avx2] [--verify]
+*/
+int main(int argc, char** argv)
+{
+    typedef std::chrono::steady_clock Clock;
+
+    uint32_t boards = 4096;
+    uint32_t steps = 2000;
+    uint32_t seed = 1;
+    uint8_t level = 0;
+    BatchSim::Kernel kernel = BatchSim::best_kernel();
+    bool verify = false;
+
+    for(int i = 1; i < argc; i++)
+    {
+        bool more = i + 1 < argc;
+
+        if(!strcmp(argv[i], "--boards") && more)
+        {
+            boards = strtoul(argv[++i], nullptr, 0);
+        }
+        else if(!strcmp(argv[i], "--steps") && more)
+        {
+            steps = strtoul(argv[++i], nullptr, 0);
+        }
+        else if(!strcmp(argv[i], "--seed") && more)
+        {
+            seed = strtoul(argv[++i], nullptr, 0);
+        }
+        else if(!strcmp(argv[i], "--level") && more)
+        {
+            level = atoi(argv[++i]);
+        }
+        else if(!strcmp(argv[i], "--kernel") && more)
+        {
+            const char* name = argv[++i];
+
+            for(uint8_t k = 0; k < 3; k++)
+            {
+                if(!strcmp(name, BatchSim::KERNEL_NAMES[k]))
+                {
+                    kernel = BatchSim::Kernel(k);
+                }
+            }
+        }
+        else if(!strcmp(argv[i], "--verify"))
+        {
+            verify = true;
+        }
+        else
+        {
+            fprintf(stderr, "usage: %s [--boards N] [--steps N] [--seed N] [--level N] [--kernel scalar|sse2|avx2] [--verify]\n",
+                    argv[0]);
+            return 1;
+        }
+    }
+
+    if(kernel > BatchSim::best_kernel())
+    {
+        fprintf(stderr, "%s kernel not supported here\n", BatchSim::KERNEL_NAMES[kernel]);
+        return 1;
+    }
+
+    BatchSim sim(boards, seed, level, kernel);
+    std::vector<GameCore> cores;
+    std::vector<uint8_t> shapes;
+
+    if(verify)
+    {
+        cores.resize(sim.boards);
+
+        for(uint32_t board = 0; board < sim.boards; board++)
+        {
+            cores[board].reset(sim.seed[board], level);
+        }
+    }
+
+    Clock::time_point start = Clock::now();
+
+    for(uint32_t i = 0; i < steps; i++)
+    {
+        if(!verify)
+        {
+            sim.step();
+            continue;
+        }
+
+        sim.choose_random();
+        shapes = sim.shape;
+        sim.drop();
+
+        if(!verify_step(sim, cores, shapes))
+        {
+            return 1;
+        }
+    }
+
+    double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+    printf("kernel %s boards %u placements %llu time %.3f s %.0f placements/s\n", BatchSim::KERNEL_NAMES[kernel],
+           sim.boards, (unsigned long long)sim.placements, seconds, sim.placements / seconds);
+    printf("games %llu mean score %.1f best score %u lines %llu\n", (unsigned long long)sim.games,
+           sim.games ? (double)sim.finished_score / sim.games : 0.0, sim.best_score,
+           (unsigned long long)sim.cleared_lines);
+
+    if(verify)
+    {
+        printf("all boards match GameCore\n");
+    }
+
+    return 0;
+}
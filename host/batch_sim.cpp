@@ -0,0 +1,282 @@
+#include "batch_sim.h"
+#include "batch_kernel.h"
+#include <cstring>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+
+const char* const BatchSim::KERNEL_NAMES[3] = {"scalar", "sse2", "avx2"};
+
+
+/**
+* One board per vector, for CPUs without a vector kernel and as reference.
+*/
+struct ScalarVector
+{
+    typedef uint16_t T;
+    static const uint8_t WIDTH = 1;
+
+    static T load(const uint16_t* p) { return *p; }
+    static void store(uint16_t* p, T a) { *p = a; }
+    static T set1(uint16_t v) { return v; }
+    static T and_(T a, T b) { return a & b; }
+    static T or_(T a, T b) { return a | b; }
+    static T andnot(T a, T b) { return ~a & b; }
+    static T add(T a, T b) { return a + b; }
+    static T sub(T a, T b) { return a - b; }
+    static T eq(T a, T b) { return a == b ? 0xFFFF : 0; }
+    static bool any(T a) { return a; }
+};
+
+
+void batch_kernel_scalar(BatchSim& sim) { batch_kernel<ScalarVector>(sim); }
+
+
+#if defined(__SSE2__)
+/**
+* 8 boards per vector, SSE2 is part of every x86-64 CPU.
+*/
+struct Sse2Vector
+{
+    typedef __m128i T;
+    static const uint8_t WIDTH = 8;
+
+    static T load(const uint16_t* p) { return _mm_loadu_si128((const __m128i*)p); }
+    static void store(uint16_t* p, T a) { _mm_storeu_si128((__m128i*)p, a); }
+    static T set1(uint16_t v) { return _mm_set1_epi16(v); }
+    static T and_(T a, T b) { return _mm_and_si128(a, b); }
+    static T or_(T a, T b) { return _mm_or_si128(a, b); }
+    static T andnot(T a, T b) { return _mm_andnot_si128(a, b); }
+    static T add(T a, T b) { return _mm_add_epi16(a, b); }
+    static T sub(T a, T b) { return _mm_sub_epi16(a, b); }
+    static T eq(T a, T b) { return _mm_cmpeq_epi16(a, b); }
+    static bool any(T a) { return _mm_movemask_epi8(a); }
+};
+
+
+void batch_kernel_sse2(BatchSim& sim) { batch_kernel<Sse2Vector>(sim); }
+#else
+void batch_kernel_sse2(BatchSim& sim) { batch_kernel_scalar(sim); }
+#endif
+
+#if !defined(TETRIS_BATCH_AVX2)
+void batch_kernel_avx2(BatchSim& sim) { batch_kernel_sse2(sim); }
+#endif
+
+
+/*
+ * Widest kernel the build and the CPU support.
+ */
+BatchSim::Kernel BatchSim::best_kernel()
+{
+#if defined(TETRIS_BATCH_AVX2)
+    if(__builtin_cpu_supports("avx2"))
+    {
+        return AVX2;
+    }
+#endif
+
+#if defined(__SSE2__)
+    return SSE2;
+#else
+    return SCALAR;
+#endif
+}
+
+
+/*
+ * Starts a game on every board, board i with seed + i, later games continue
+ * the seed count.
+ */
+BatchSim::BatchSim(uint32_t boards, uint32_t seed, uint8_t start_level, Kernel kernel)
+    : boards((boards + LANES - 1) / LANES * LANES), start_level(start_level), kernel(kernel)
+{
+    uint32_t n = this->boards;
+
+    rows.assign(PADDED_ROWS * n, 0);
+    piece.assign(4 * n, 0);
+    depth.assign(n, 0);
+    cleared.assign(n, 0);
+    shape.assign(n, 0);
+    preview.assign(GameCore::PREVIEW_LENGTH * n, 0);
+    rng.assign(n, 0);
+    score.assign(n, 0);
+    lines.assign(n, 0);
+    level.assign(n, 0);
+    this->seed.assign(n, 0);
+    rotation.assign(n, 0);
+    column.assign(n, 0);
+    policy_rng.assign(n, 0);
+    topped_out.assign(n, 0);
+
+    placements = 0;
+    cleared_lines = 0;
+    games = 0;
+    finished_score = 0;
+    best_score = 0;
+    next_seed = seed;
+
+    for(uint8_t y = ROWS; y < PADDED_ROWS; y++)
+    {
+        memset(&rows[y * n], 0xFF, n * sizeof(rows[0]));
+    }
+
+    for(uint32_t board = 0; board < n; board++)
+    {
+        policy_rng[board] = (seed + board) * 2654435761u | 1;
+        reset_board(board);
+    }
+}
+
+
+/*
+ * New game on one board, same start as GameCore::reset.
+ */
+void BatchSim::reset_board(uint32_t board)
+{
+    uint32_t n = boards;
+
+    for(uint8_t y = 0; y < ROWS; y++)
+    {
+        rows[y * n + board] = 0;
+    }
+
+    seed[board] = next_seed++;
+    rng[board] = seed[board] ? seed[board] : 1;
+    score[board] = 0;
+    lines[board] = 0;
+    level[board] = start_level < GameCore::MAX_LEVEL ? start_level : GameCore::MAX_LEVEL;
+
+    for(uint8_t i = 0; i < GameCore::PREVIEW_LENGTH; i++)
+    {
+        rng[board] ^= rng[board] << 13;
+        rng[board] ^= rng[board] >> 17;
+        rng[board] ^= rng[board] << 5;
+        preview[i * n + board] = rng[board] % 7;
+    }
+
+    spawn(board);
+}
+
+
+/*
+ * Next shape of a board from its preview, same sequence as GameCore::spawn_block.
+ */
+void BatchSim::spawn(uint32_t board)
+{
+    uint32_t n = boards;
+
+    shape[board] = preview[board];
+
+    for(uint8_t i = 1; i < GameCore::PREVIEW_LENGTH; i++)
+    {
+        preview[(i - 1) * n + board] = preview[i * n + board];
+    }
+
+    rng[board] ^= rng[board] << 13;
+    rng[board] ^= rng[board] >> 17;
+    rng[board] ^= rng[board] << 5;
+    preview[(GameCore::PREVIEW_LENGTH - 1) * n + board] = rng[board] % 7;
+}
+
+
+/*
+ * Random rotation and column for every board, always inside the field.
+ */
+void BatchSim::choose_random()
+{
+    for(uint32_t board = 0; board < boards; board++)
+    {
+        uint32_t r = policy_rng[board];
+
+        r ^= r << 13;
+        r ^= r >> 17;
+        r ^= r << 5;
+        policy_rng[board] = r;
+
+        rotation[board] = r & 3;
+        uint8_t width = Block::PIECES.states[shape[board]][rotation[board]].width;
+        column[board] = ((r >> 8) & 0xFFFF) * (GameCore::SQUARES_PER_ROW + 1 - width) >> 16;
+    }
+}
+
+
+/*
+ * One random placement on every board.
+ */
+void BatchSim::step()
+{
+    choose_random();
+    drop();
+}
+
+
+/*
+ * Drops the current piece of every board at its chosen rotation and column.
+ * Locking with the block center in the top row ends a game like in GameCore,
+ * the board then starts over with the next seed.
+ */
+void BatchSim::drop()
+{
+    uint32_t n = boards;
+
+    for(uint32_t board = 0; board < n; board++)
+    {
+        const PieceState& state = Block::PIECES.states[shape[board]][rotation[board]];
+
+        for(uint8_t k = 0; k < 4; k++)
+        {
+            piece[k * n + board] = ((state.mask >> (k * 4)) & 0xF) << column[board];
+        }
+    }
+
+    switch(kernel)
+    {
+        case AVX2:
+            batch_kernel_avx2(*this);
+            break;
+        case SSE2:
+            batch_kernel_sse2(*this);
+            break;
+        default:
+            batch_kernel_scalar(*this);
+            break;
+    }
+
+    for(uint32_t board = 0; board < n; board++)
+    {
+        const PieceState& state = Block::PIECES.states[shape[board]][rotation[board]];
+        uint8_t full_lines = cleared[board];
+
+        placements++;
+        topped_out[board] = false;
+
+        // The piece did not fit at all, otherwise it scores its lines first.
+        if(depth[board] && full_lines)
+        {
+            score[board] += GameCore::line_points(full_lines, level[board]);
+            lines[board] += full_lines;
+            cleared_lines += full_lines;
+
+            if(GameCore::levels_up(lines[board], level[board]))
+            {
+                level[board]++;
+            }
+        }
+
+        // Center row of the locked block is depth - 1 - top.
+        if(GameCore::tops_out((int16_t)depth[board] - 1 - state.top))
+        {
+            games++;
+            finished_score += score[board];
+            best_score = score[board] > best_score ? score[board] : best_score;
+            topped_out[board] = true;
+            reset_board(board);
+            continue;
+        }
+
+        spawn(board);
+    }
+}
@@ -0,0 +1,88 @@
+#ifndef BATCH_SIM_H_
+#define BATCH_SIM_H_
+
+#include "game_core.h"
+#include <stdint.h>
+#include <vector>
+
+
+/**
+* Many games advanced in lockstep, one piece placement per board and step.
+* Boards are kept as structure of arrays: plane y of rows holds row y of every
+* board, so the drop, full row detection and row compaction run across boards
+* with AVX2 or SSE2, scalar elsewhere. A piece is hard dropped from the top of
+* the field at the rotation and column in rotation[] and column[], scoring,
+* line clears, levels and the block sequence follow GameCore.
+*/
+class BatchSim
+{
+  public:
+    static const uint8_t ROWS = GameCore::SQUARES_PER_COLUMN;
+    // Full rows below the field stop every drop.
+    static const uint8_t PADDED_ROWS = ROWS + 4;
+    // Boards are rounded up to the widest kernel.
+    static const uint8_t LANES = 16;
+
+    enum Kernel : uint8_t
+    {
+        SCALAR,
+        SSE2,
+        AVX2
+    };
+
+    static const char* const KERNEL_NAMES[3];
+
+    uint32_t boards;
+    uint8_t start_level;
+    Kernel kernel;
+
+    // Row occupancy planes, rows[y * boards + board].
+    std::vector<uint16_t> rows;
+    // Piece rows at the chosen column, piece[r * boards + board] is row r below its top.
+    std::vector<uint16_t> piece;
+    // Kernel results, top rows the piece passed on the way down and full rows cleared.
+    std::vector<uint16_t> depth;
+    std::vector<uint16_t> cleared;
+
+    // Per board game state.
+    std::vector<uint8_t> shape;
+    std::vector<uint8_t> preview;
+    std::vector<uint32_t> rng;
+    std::vector<uint32_t> score;
+    std::vector<uint16_t> lines;
+    std::vector<uint8_t> level;
+    std::vector<uint32_t> seed;
+    // Placement of the current piece, set by the policy before drop().
+    std::vector<uint8_t> rotation;
+    std::vector<uint8_t> column;
+    std::vector<uint32_t> policy_rng;
+    // Set for boards whose last drop ended the game, cleared by the next step.
+    std::vector<uint8_t> topped_out;
+
+    // Totals over all boards.
+    uint64_t placements;
+    uint64_t cleared_lines;
+    uint64_t games;
+    uint64_t finished_score;
+    uint32_t best_score;
+
+    BatchSim(uint32_t boards, uint32_t seed, uint8_t start_level, Kernel kernel);
+    static Kernel best_kernel();
+    void step();
+    void choose_random();
+    void drop();
+    void reset_board(uint32_t board);
+
+  private:
+    uint32_t next_seed;
+
+    void spawn(uint32_t board);
+};
+
+
+// Kernels, one per instruction set, all with the same results.
+void batch_kernel_scalar(BatchSim& sim);
+void batch_kernel_sse2(BatchSim& sim);
+void batch_kernel_avx2(BatchSim& sim);
+
+#endif
@@ -0,0 +1,27 @@
+#include "batch_kernel.h"
+#include <immintrin.h>
+
+
+/**
+* 16 boards per vector, this file is built with AVX2 enabled and only called
+* after a CPU check.
+*/
+struct Avx2Vector
+{
+    typedef __m256i T;
+    static const uint8_t WIDTH = 16;
+
+    static T load(const uint16_t* p) { return _mm256_loadu_si256((const __m256i*)p); }
+    static void store(uint16_t* p, T a) { _mm256_storeu_si256((__m256i*)p, a); }
+    static T set1(uint16_t v) { return _mm256_set1_epi16(v); }
+    static T and_(T a, T b) { return _mm256_and_si256(a, b); }
+    static T or_(T a, T b) { return _mm256_or_si256(a, b); }
+    static T andnot(T a, T b) { return _mm256_andnot_si256(a, b); }
+    static T add(T a, T b) { return _mm256_add_epi16(a, b); }
+    static T sub(T a, T b) { return _mm256_sub_epi16(a, b); }
+    static T eq(T a, T b) { return _mm256_cmpeq_epi16(a, b); }
+    static bool any(T a) { return !_mm256_testz_si256(a, a); }
+};
+
+
+void batch_kernel_avx2(BatchSim& sim) { batch_kernel<Avx2Vector>(sim); }
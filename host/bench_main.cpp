@@ -0,0 +1,82 @@
+#include "bench.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+
+
+/*
+* Heap allocations of the whole process, counted through operator new.
+*/
+static uint64_t allocations;
+
+void* operator new(size_t size)
+{
+    allocations++;
+
+    if(void* p = malloc(size ? size : 1))
+    {
+        return p;
+    }
+
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept { free(p); }
+void operator delete(void* p, size_t) noexcept { free(p); }
+
+
+/*
+* Runs every case on every board and prints ns/op and allocations/op.
+* Iterations double until a case runs for at least the minimum time.
+*
+* usage: tetris_bench [min_ms]
+*/
+int main(int argc, char** argv)
+{
+    typedef std::chrono::steady_clock Clock;
+
+    uint32_t min_ms = argc > 1 ? strtoul(argv[1], nullptr, 0) : 200;
+
+    static Tetris tetris;
+    uint32_t checksum = 0;
+
+    printf("%-18s %-14s %12s %12s %10s\n", "case", "board", "iterations", "ns/op", "allocs/op");
+
+    for(uint8_t b = 0; b < Bench::BOARD_COUNT; b++)
+    {
+        for(uint8_t c = 0; c < Bench::CASE_COUNT; c++)
+        {
+            uint32_t iterations = 1000;
+            double elapsed_ns = 0;
+            uint64_t allocated = 0;
+
+            while(true)
+            {
+                Bench::setup_board(tetris, Bench::Board(b));
+                tetris.publish();
+                tetris.render();
+
+                uint64_t allocations_before = allocations;
+                Clock::time_point start = Clock::now();
+                checksum += Bench::run(tetris, Bench::Case(c), iterations);
+                elapsed_ns = std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+                allocated = allocations - allocations_before;
+
+                if(elapsed_ns >= min_ms * 1e6 || iterations >= (1u << 30))
+                {
+                    break;
+                }
+
+                iterations *= 2;
+            }
+
+            printf("%-18s %-14s %12u %12.2f %10.3f\n", Bench::CASE_NAMES[c], Bench::BOARD_NAMES[b], iterations,
+                   elapsed_ns / iterations, (double)allocated / iterations);
+        }
+    }
+
+    fprintf(stderr, "checksum %08x\n", checksum);
+
+    return 0;
+}
@@ -0,0 +1,53 @@
+#include "display.h"
+#include <cstdio>
+#include <cstring>
+
+
+/*
+* Draws numbers from the digit atlas and the same numbers as text, at the
+* score and level positions and cut off at the left edge, and checks that
+* both frame buffers match pixel for pixel.
+*
+* usage: tetris_digits
+*/
+int main()
+{
+    static Display atlas;
+    static Display text;
+    static const uint16_t RIGHTS[] = {121, 20, 15};
+    uint32_t numbers[64] = {0, 1, 7, 10, 42, 99, 100, 1234, 56789, 999999, 4294967295u};
+    uint32_t state = 1;
+    int failures = 0;
+
+    // Xorshift32 fills the rest with numbers of every length.
+    for(uint8_t i = 11; i < 64; i++)
+    {
+        state ^= state << 13;
+        state ^= state >> 17;
+        state ^= state << 5;
+        numbers[i] = state >> (i % 32);
+    }
+
+    for(uint16_t right : RIGHTS)
+    {
+        for(uint32_t number : numbers)
+        {
+            char decimal[DigitAtlas::MAX_DIGITS + 1];
+            snprintf(decimal, sizeof(decimal), "%u", number);
+
+            atlas.fill(TFT_BLACK);
+            atlas.number(number, right, 3, TFT_GREENYELLOW);
+            text.fill(TFT_BLACK);
+            text.text_right(decimal, right, 3, TFT_GREENYELLOW);
+
+            if(memcmp(atlas.framebuffer, text.framebuffer, sizeof(atlas.framebuffer)))
+            {
+                printf("MISMATCH %s right edge %u\n", decimal, right);
+                failures++;
+            }
+        }
+    }
+
+    printf("%s\n", failures ? "FAIL" : "OK");
+    return failures ? 1 : 0;
+}
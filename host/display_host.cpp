@@ -0,0 +1,342 @@
+#include "display.h"
+#include "trace.h"
+#include <cstdlib>
+#include <cstring>
+
+
+/*
+* Stand-in for FSB9 with the metrics of an Adafruit GFX font, digits only.
+* The glyphs are 4x7 outlines drawn at twice their size, the leftmost pixel
+* of an outline row in bit 3.
+*/
+struct HostGlyph
+{
+    uint8_t width;
+    uint8_t height;
+    uint8_t x_advance;
+    int8_t x_offset;
+    int8_t y_offset;
+};
+
+static const uint8_t OUTLINE_SCALE = 2;
+static const HostGlyph DIGIT_GLYPH = {4 * OUTLINE_SCALE, 7 * OUTLINE_SCALE, 10, 1, -7 * OUTLINE_SCALE};
+static const uint8_t OUTLINES[10][7] = {
+    {0x6, 0x9, 0x9, 0x9, 0x9, 0x9, 0x6},
+    {0x2, 0x6, 0x2, 0x2, 0x2, 0x2, 0x7},
+    {0x6, 0x9, 0x1, 0x2, 0x4, 0x8, 0xF},
+    {0xE, 0x1, 0x1, 0x6, 0x1, 0x1, 0xE},
+    {0x2, 0x6, 0xA, 0xA, 0xF, 0x2, 0x2},
+    {0xF, 0x8, 0xE, 0x1, 0x1, 0x9, 0x6},
+    {0x6, 0x8, 0x8, 0xE, 0x9, 0x9, 0x6},
+    {0xF, 0x1, 0x2, 0x2, 0x4, 0x4, 0x4},
+    {0x6, 0x9, 0x9, 0x6, 0x9, 0x9, 0x6},
+    {0x6, 0x9, 0x9, 0x7, 0x1, 0x1, 0x6},
+};
+
+
+Display::Display()
+{
+    memset(framebuffer, 0, sizeof(framebuffer));
+    memset(panel, 0, sizeof(panel));
+    flushed_pixels = 0;
+
+    rasterize_digits();
+}
+
+uint8_t* Display::pixels() { return (uint8_t*)framebuffer; }
+
+
+/*
+* Clipped rectangle fill, base of all drawing operations.
+* Takes an RGB565 color, the buffer gets what Display::ink() makes of it.
+*/
+static void fill_clipped(Display::Pixels buffer, int16_t x, int16_t y, int16_t width, int16_t height, uint32_t color)
+{
+    if(x < 0)
+    {
+        width += x;
+        x = 0;
+    }
+
+    if(y < 0)
+    {
+        height += y;
+        y = 0;
+    }
+
+    if(x + width > Display::WIDTH)
+    {
+        width = Display::WIDTH - x;
+    }
+
+    if(y + height > Display::HEIGHT)
+    {
+        height = Display::HEIGHT - y;
+    }
+
+    if(width <= 0 || height <= 0)
+    {
+        return;
+    }
+
+#if DISPLAY_BPP == 4
+    uint8_t index = Display::ink(color);
+
+    // Odd edges share their byte with a neighbour, the bytes in between are set whole.
+    for(int16_t row = y; row < y + height; row++)
+    {
+        uint8_t* line = buffer + row * Display::WIDTH / 2;
+        int16_t column = x;
+        int16_t end = x + width;
+
+        if(column & 1)
+        {
+            line[column / 2] = (line[column / 2] & 0xF0) | index;
+            column++;
+        }
+
+        if(end & 1 && column < end)
+        {
+            line[end / 2] = (line[end / 2] & 0x0F) | index << 4;
+            end--;
+        }
+
+        memset(line + column / 2, index * 0x11, (end - column) / 2);
+    }
+#else
+    for(int16_t row = y; row < y + height; row++)
+    {
+        for(int16_t column = x; column < x + width; column++)
+        {
+            buffer[row * Display::WIDTH + column] = color;
+        }
+    }
+#endif
+}
+
+/*
+* Line from (x1, y1) to (x2, y2).
+*/
+void Display::line(uint8_t x1, uint8_t y1, uint8_t x2, uint8_t y2, uint32_t color)
+{
+    int16_t dx = abs(x2 - x1);
+    int16_t dy = -abs(y2 - y1);
+    int8_t sx = x1 < x2 ? 1 : -1;
+    int8_t sy = y1 < y2 ? 1 : -1;
+    int16_t error = dx + dy;
+    int16_t x = x1;
+    int16_t y = y1;
+
+    while(true)
+    {
+        fill_clipped(framebuffer, x, y, 1, 1, color);
+
+        if(x == x2 && y == y2)
+        {
+            break;
+        }
+
+        if(2 * error >= dy)
+        {
+            error += dy;
+            x += sx;
+        }
+
+        if(2 * error <= dx)
+        {
+            error += dx;
+            y += sy;
+        }
+    }
+}
+
+/**
+ * Draws a vertical line.
+ */
+void Display::vline(uint8_t x1, uint8_t y1, uint8_t length, uint32_t color)
+{
+    fill_clipped(framebuffer, x1, y1, 1, length + 1, color);
+}
+
+/*
+* Filled rectangle.
+*/
+void Display::filled_rectangle(uint8_t x, uint8_t y, uint8_t width, uint8_t height, uint32_t color)
+{
+    fill_clipped(framebuffer, x, y, width, height, color);
+}
+
+/*
+* Right aligned number with its top right corner at (x, y), over a box of
+* TEXT_BACKGROUND like the device draws it.
+*/
+void Display::number(uint32_t number, uint16_t x, uint16_t y, uint32_t color)
+{
+    uint8_t glyphs[DigitAtlas::MAX_DIGITS];
+    uint8_t count = DigitAtlas::format(number, glyphs);
+    int16_t left = x - digits.width(glyphs, count);
+
+    fill_clipped(framebuffer, left, y, x - left, digits.height, TEXT_BACKGROUND);
+
+    for(uint8_t i = count; i-- > 0; left += digits.advance[glyphs[i]])
+    {
+        const uint16_t* glyph = digits.rows[glyphs[i]];
+
+        // Each run of set pixels in a glyph row is one fill.
+        for(uint8_t row = 0; row < digits.height; row++)
+        {
+            uint8_t column = 0;
+
+            while(column < DigitAtlas::MAX_WIDTH)
+            {
+                if(!(glyph[row] & (0x8000 >> column)))
+                {
+                    column++;
+                    continue;
+                }
+
+                uint8_t start = column;
+
+                while(column < DigitAtlas::MAX_WIDTH && glyph[row] & (0x8000 >> column))
+                {
+                    column++;
+                }
+
+                fill_clipped(framebuffer, left + start, y + row, column - start, 1, color);
+            }
+        }
+    }
+}
+
+/*
+* Right aligned text with its top right corner at (x, y), drawn the way
+* TFT_eSPI draws free fonts: a TEXT_BACKGROUND box from the top of the
+* tallest glyph to the bottom of the deepest one, then every glyph at its
+* offset from the pen on the baseline. Only digits have glyphs.
+*/
+void Display::text_right(const char* text, uint16_t x, uint16_t y, uint32_t color)
+{
+    int16_t pen = x - text_width(text);
+    int16_t baseline = y - DIGIT_GLYPH.y_offset;
+
+    fill_clipped(framebuffer, pen, y, x - pen, DIGIT_GLYPH.height, TEXT_BACKGROUND);
+
+    for(; *text; text++)
+    {
+        if(*text < '0' || *text > '9')
+        {
+            continue;
+        }
+
+        const uint8_t* outline = OUTLINES[*text - '0'];
+
+        for(uint8_t row = 0; row < DIGIT_GLYPH.height; row++)
+        {
+            for(uint8_t column = 0; column < DIGIT_GLYPH.width; column++)
+            {
+                if(outline[row / OUTLINE_SCALE] >> (3 - column / OUTLINE_SCALE) & 1)
+                {
+                    fill_clipped(framebuffer, pen + DIGIT_GLYPH.x_offset + column, baseline + DIGIT_GLYPH.y_offset + row,
+                                 1, 1, color);
+                }
+            }
+        }
+
+        pen += DIGIT_GLYPH.x_advance;
+    }
+}
+
+
+/*
+* Width of text, the sum of the glyph advances.
+*/
+uint16_t Display::text_width(const char* text)
+{
+    uint16_t width = 0;
+
+    for(; *text; text++)
+    {
+        width += *text >= '0' && *text <= '9' ? DIGIT_GLYPH.x_advance : 0;
+    }
+
+    return width;
+}
+
+
+/*
+* Value the frame buffer holds at (x, y), a palette index in palette mode.
+*/
+uint32_t Display::read_pixel(uint8_t x, uint8_t y)
+{
+#if DISPLAY_BPP == 4
+    uint8_t pair = framebuffer[(y * WIDTH + x) / 2];
+    return x & 1 ? pair & 0xF : pair >> 4;
+#else
+    return framebuffer[y * WIDTH + x];
+#endif
+}
+
+/*
+* Fill display with color.
+*/
+void Display::fill(uint32_t color) { fill_clipped(framebuffer, 0, 0, WIDTH, HEIGHT, color); }
+
+/*
+* Flush frame buffer into the panel.
+*/
+void Display::flush() { flush(0, 0, WIDTH, HEIGHT); }
+
+/*
+* Flush a window of the frame buffer into the same window of the panel.
+*/
+void Display::flush(uint8_t x, uint8_t y, uint8_t width, uint8_t height)
+{
+    TRACE_SPAN(FLUSH);
+
+    if(x >= WIDTH || y >= HEIGHT)
+    {
+        return;
+    }
+
+    if(x + width > WIDTH)
+    {
+        width = WIDTH - x;
+    }
+
+    if(y + height > HEIGHT)
+    {
+        height = HEIGHT - y;
+    }
+
+    for(uint8_t row = y; row < y + height; row++)
+    {
+#if DISPLAY_BPP == 4
+        // Palette expansion on the way out, like the device does per SPI line.
+        const uint8_t* line = framebuffer + row * WIDTH / 2;
+        uint16_t* out = panel + row * WIDTH;
+        uint8_t column = x;
+        uint8_t end = x + width;
+
+        if(column & 1)
+        {
+            out[column] = PALETTE[line[column / 2] & 0xF];
+            column++;
+        }
+
+        for(; column + 1 < end; column += 2)
+        {
+            out[column] = PALETTE[line[column / 2] >> 4];
+            out[column + 1] = PALETTE[line[column / 2] & 0xF];
+        }
+
+        if(column < end)
+        {
+            out[column] = PALETTE[line[column / 2] >> 4];
+        }
+#else
+        memcpy(&panel[row * WIDTH + x], &framebuffer[row * WIDTH + x], width * sizeof(uint16_t));
+#endif
+    }
+
+    flushed_pixels += width * height;
+}
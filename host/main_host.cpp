@@ -0,0 +1,486 @@
+#include "tetris.h"
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <mutex>
+#include <random>
+#include <thread>
+
+
+/*
+* Writes the panel content as binary PPM.
+*/
+static void write_ppm(const Display& display, const char* path)
+{
+    FILE* file = fopen(path, "wb");
+
+    if(!file)
+    {
+        perror(path);
+        return;
+    }
+
+    fprintf(file, "P6\n%u %u\n255\n", Display::WIDTH, Display::HEIGHT);
+
+    for(uint32_t i = 0; i < Display::WIDTH * Display::HEIGHT; i++)
+    {
+        uint16_t c = display.panel[i];
+        uint8_t rgb[3] = {(uint8_t)((c >> 11) << 3), (uint8_t)(((c >> 5) & 0x3F) << 2), (uint8_t)((c & 0x1F) << 3)};
+        fwrite(rgb, 1, 3, file);
+    }
+
+    fclose(file);
+}
+
+
+/*
+* Appends the queued telemetry records to a stream.
+*/
+static void drain_telemetry(Telemetry& telemetry, FILE* file)
+{
+    uint8_t buffer[Telemetry::RECORD_SIZE * 8];
+    uint16_t length;
+
+    while((length = telemetry.flush(buffer, sizeof(buffer))))
+    {
+        fwrite(buffer, 1, length, file);
+    }
+}
+
+
+#if TETRIS_TRACE
+/*
+* Appends the spans recorded so far to a trace dump.
+*/
+static void drain_trace(FILE* file)
+{
+    uint8_t buffer[Trace::RECORD_SIZE * 64];
+    uint16_t length;
+
+    while((length = Trace::flush(buffer, sizeof(buffer))))
+    {
+        fwrite(buffer, 1, length, file);
+    }
+}
+#endif
+
+
+/*
+* Headless game on a virtual clock, played by random button presses or by
+* the bot. Rendering runs on its own thread unless --inline is given, a
+* recording is written by a third one.
+*
+* usage: tetris_host [--seed N] [--seconds N] [--level N] [--bot] [--tt-mb N] [--inline] [--ppm out.ppm] [--record out.trpl] [--stats]
+*                    [--trace out.ttrc] [--telemetry out.ttlm] [--storage state.bin]
+*/
+int main(int argc, char** argv)
+{
+    uint32_t seed = 1;
+    uint32_t seconds = 600;
+    int level = -1;
+    bool bot = false;
+    bool pipelined = true;
+    uint32_t table_mb = 16;
+    const char* ppm = nullptr;
+    const char* record = nullptr;
+    bool stats = false;
+    const char* trace = nullptr;
+    const char* events = nullptr;
+
+    for(int i = 1; i < argc; i++)
+    {
+        bool more = i + 1 < argc;
+
+        if(!strcmp(argv[i], "--seed") && more)
+        {
+            seed = strtoul(argv[++i], nullptr, 0);
+        }
+        else if(!strcmp(argv[i], "--seconds") && more)
+        {
+            seconds = strtoul(argv[++i], nullptr, 0);
+        }
+        else if(!strcmp(argv[i], "--level") && more)
+        {
+            level = atoi(argv[++i]);
+        }
+        else if(!strcmp(argv[i], "--bot"))
+        {
+            bot = true;
+        }
+        else if(!strcmp(argv[i], "--tt-mb") && more)
+        {
+            table_mb = strtoul(argv[++i], nullptr, 0);
+        }
+        else if(!strcmp(argv[i], "--inline"))
+        {
+            pipelined = false;
+        }
+        else if(!strcmp(argv[i], "--ppm") && more)
+        {
+            ppm = argv[++i];
+        }
+        else if(!strcmp(argv[i], "--record") && more)
+        {
+            record = argv[++i];
+        }
+        else if(!strcmp(argv[i], "--stats"))
+        {
+            stats = true;
+        }
+        else if(!strcmp(argv[i], "--trace") && more)
+        {
+            trace = argv[++i];
+        }
+        else if(!strcmp(argv[i], "--telemetry") && more)
+        {
+            events = argv[++i];
+        }
+        else if(!strcmp(argv[i], "--storage") && more)
+        {
+            HostPlatform::storage_path = argv[++i];
+        }
+        else
+        {
+            fprintf(stderr, "usage: %s [--seed N] [--seconds N] [--level N] [--bot] [--tt-mb N] [--inline] [--ppm out.ppm] [--record out.trpl] [--stats]\n"
+                    "       [--trace out.ttrc] [--telemetry out.ttlm] [--storage state.bin]\n", argv[0]);
+            return 1;
+        }
+    }
+
+#if !TETRIS_TRACE
+    if(trace)
+    {
+        fprintf(stderr, "built without TETRIS_TRACE, configure with -DTETRIS_TRACE=ON\n");
+        return 1;
+    }
+#endif
+
+    static const uint8_t PINS[] = {Tetris::PIN_MOVE_LEFT, Tetris::PIN_MOVE_RIGHT, Tetris::PIN_ROTATE_LEFT, Tetris::PIN_ROTATE_RIGHT};
+
+    HostPlatform::seed(seed);
+    std::mt19937 input_rng(seed);
+    // Random presses about every 200 ms, held between 30 and 400 ms so long ones auto shift.
+    std::geometric_distribution<uint32_t> press_gap(1.0 / 200);
+    uint32_t press_time = press_gap(input_rng);
+    uint32_t release_time[4] = {0, 0, 0, 0};
+
+    static Tetris tetris;
+    static Autoplayer autoplayer;
+    WorkPool pool;
+    std::vector<uint8_t> table_memory(table_mb << 20);
+    TranspositionTable table(table_memory.data(), table_memory.size());
+
+    if(level >= 0)
+    {
+        tetris.core.reset(HostPlatform::random(), level);
+    }
+
+    // A saved game that is not over continues where it was saved.
+    if(HostPlatform::storage_path && tetris.resume())
+    {
+        printf("resumed frame %u score %u level %u lines %u\n", tetris.core.frame, tetris.core.score,
+               tetris.core.level, tetris.core.cleared_lines);
+    }
+
+    if(bot)
+    {
+        autoplayer.synchronous = true;
+        autoplayer.bot.pool = &pool;
+        autoplayer.bot.table = table_mb ? &table : nullptr;
+        tetris.autoplayer = &autoplayer;
+    }
+
+    bool running = true;
+    std::mutex flushed_mutex;
+    std::condition_variable flushed;
+    std::thread renderer;
+    std::thread writer;
+    std::mutex record_mutex;
+    std::condition_variable record_ready;
+    static ReplayRecorder recorder;
+    FILE* record_file = nullptr;
+    uint32_t record_bytes = 0;
+
+    if(record)
+    {
+        record_file = fopen(record, "wb");
+
+        if(!record_file)
+        {
+            perror(record);
+            return 1;
+        }
+
+        uint8_t header[Replay::HEADER_SIZE];
+        record_bytes += fwrite(header, 1, Replay::write_header(header, tetris.core), record_file);
+        tetris.recorder = &recorder;
+
+        writer = std::thread(
+            [&]()
+            {
+                uint8_t buffer[256];
+                bool more = true;
+
+                // Sleeps until the game loop recorded something, one last pass
+                // after it stopped picks up the remaining events.
+                while(more)
+                {
+                    {
+                        std::unique_lock<std::mutex> lock(record_mutex);
+                        record_ready.wait(lock, [&]()
+                                          { return recorder.pending() || !__atomic_load_n(&running, __ATOMIC_ACQUIRE); });
+                        more = __atomic_load_n(&running, __ATOMIC_ACQUIRE);
+                    }
+
+                    uint16_t length;
+
+                    while((length = recorder.flush(buffer, sizeof(buffer))))
+                    {
+                        record_bytes += fwrite(buffer, 1, length, record_file);
+                    }
+                }
+            });
+    }
+
+    FILE* trace_file = nullptr;
+
+    if(trace)
+    {
+        trace_file = fopen(trace, "wb");
+
+        if(!trace_file)
+        {
+            perror(trace);
+            return 1;
+        }
+
+        uint8_t header[Trace::HEADER_SIZE];
+        fwrite(header, 1, Trace::write_header(header), trace_file);
+    }
+
+    static Telemetry telemetry;
+    FILE* telemetry_file = nullptr;
+
+    if(events)
+    {
+        telemetry_file = fopen(events, "wb");
+
+        if(!telemetry_file)
+        {
+            perror(events);
+            return 1;
+        }
+
+        uint8_t header[Telemetry::HEADER_SIZE];
+        fwrite(header, 1, Telemetry::write_header(header), telemetry_file);
+        tetris.telemetry = &telemetry;
+    }
+
+    // The game loop traces as core 0 and the renderer as core 1.
+    HostPlatform::core_number = 0;
+
+    if(pipelined)
+    {
+        tetris.pipelined = true;
+        renderer = std::thread(
+            [&]()
+            {
+                HostPlatform::core_number = 1;
+
+                while(__atomic_load_n(&running, __ATOMIC_ACQUIRE))
+                {
+                    if(!tetris.render())
+                    {
+                        HostPlatform::wait_signal();
+                        continue;
+                    }
+
+                    // Taking the lock orders the release of the frame before the wake up.
+                    {
+                        std::lock_guard<std::mutex> lock(flushed_mutex);
+                    }
+
+                    flushed.notify_all();
+                }
+            });
+    }
+
+    std::clock_t cpu_start = std::clock();
+
+    while(!tetris.core.game_over && HostPlatform::millis() < seconds * 1000)
+    {
+        uint32_t now = HostPlatform::millis();
+        uint32_t wake = seconds * 1000;
+
+        if(!bot)
+        {
+            if(now >= press_time)
+            {
+                uint8_t button = input_rng() % 4;
+
+                HostPlatform::hold(PINS[button]);
+                release_time[button] = now + 30 + input_rng() % 370;
+                press_time = now + 1 + press_gap(input_rng);
+            }
+
+            wake = press_time < wake ? press_time : wake;
+
+            for(uint8_t button = 0; button < 4; button++)
+            {
+                if(!HostPlatform::input_read(PINS[button]))
+                {
+                    continue;
+                }
+
+                if(now >= release_time[button])
+                {
+                    HostPlatform::release(PINS[button]);
+                }
+                else if(release_time[button] < wake)
+                {
+                    wake = release_time[button];
+                }
+            }
+        }
+
+        tetris.tick();
+
+        // The virtual clock waits for the renderer to flush what was published,
+        // so the panel and the latency statistics keep pace with the game.
+        if(pipelined)
+        {
+            std::unique_lock<std::mutex> lock(flushed_mutex);
+            flushed.wait(lock, [&]() { return tetris.frames.empty(); });
+        }
+
+        // Taking the lock orders the recorded events before the wake up.
+        if(record_file && recorder.pending())
+        {
+            {
+                std::lock_guard<std::mutex> lock(record_mutex);
+            }
+
+            record_ready.notify_one();
+        }
+
+        // The background step of the channel, a small buffer flushes in chunks.
+        if(telemetry_file)
+        {
+            drain_telemetry(telemetry, telemetry_file);
+        }
+
+#if TETRIS_TRACE
+        // Drained between ticks, the renderer keeps producing meanwhile.
+        if(trace_file)
+        {
+            drain_trace(trace_file);
+        }
+#endif
+
+        // The scheduler sleeps on the virtual clock, at most until the next scripted input.
+        HostPlatform::wake_time = (uint64_t)wake * 1000;
+        tetris.sleep();
+    }
+
+    double cpu_seconds = (double)(std::clock() - cpu_start) / CLOCKS_PER_SEC;
+
+    __atomic_store_n(&running, false, __ATOMIC_RELEASE);
+
+    if(record_file)
+    {
+        {
+            std::lock_guard<std::mutex> lock(record_mutex);
+        }
+
+        record_ready.notify_one();
+        writer.join();
+
+        uint8_t end[Replay::MAX_EVENT_SIZE + Replay::TRAILER_SIZE];
+        record_bytes += fwrite(end, 1, recorder.finish(end, tetris.core), record_file);
+        fclose(record_file);
+    }
+
+    if(pipelined)
+    {
+        HostPlatform::signal();
+        renderer.join();
+
+        // The ring may be full of older frames, the final state goes in after them.
+        tetris.render();
+        tetris.publish();
+        tetris.render();
+    }
+
+    uint32_t hash = 2166136261u;
+
+    for(uint32_t i = 0; i < Display::WIDTH * Display::HEIGHT; i++)
+    {
+        hash = (hash ^ tetris.display.panel[i]) * 16777619u;
+    }
+
+    printf("seed %u time %u ms pieces %u score %u level %u lines %u game_over %d\n", seed, HostPlatform::millis(),
+           tetris.core.pieces, tetris.core.score, tetris.core.level, tetris.core.cleared_lines, tetris.core.game_over);
+    printf("flushed %u pixels, panel hash %08x\n", tetris.display.flushed_pixels, hash);
+
+    double game_seconds = HostPlatform::millis() / 1000.0;
+
+    if(game_seconds > 0)
+    {
+        // Idle time is virtual here, the CPU time is what the scheduler saves.
+        printf("cpu %.3f ms per game second, %.1f wakeups per game second\n", cpu_seconds * 1000 / game_seconds,
+               tetris.wakeups / game_seconds);
+    }
+
+    const InputQueue& inputs = Tetris::input_queue;
+
+    if(inputs.handled)
+    {
+        printf("inputs %u dropped %u latency mean %llu us max %u us\n", inputs.handled, inputs.dropped,
+               (unsigned long long)(inputs.latency_sum / inputs.handled), inputs.latency_max);
+    }
+
+    if(record_file)
+    {
+        printf("recorded %u bytes, %u events dropped\n", record_bytes, recorder.dropped);
+    }
+
+    if(telemetry_file)
+    {
+        drain_telemetry(telemetry, telemetry_file);
+        fclose(telemetry_file);
+        printf("telemetry records dropped %u\n", telemetry.dropped);
+    }
+
+#if TETRIS_TRACE
+    if(trace_file)
+    {
+        drain_trace(trace_file);
+        fclose(trace_file);
+        printf("trace spans dropped %u on core 0, %u on core 1\n", Trace::dropped[0], Trace::dropped[1]);
+    }
+#endif
+
+    // Saved like a pause at the end of the run.
+    if(HostPlatform::storage_path && !tetris.core.game_over)
+    {
+        tetris.save();
+    }
+
+    if(stats)
+    {
+        // Durations are real time, the latency is on the virtual game clock, which
+        // waits for every flush when pipelined.
+        char text[512];
+        tetris.stats.format(text, sizeof(text));
+        fputs(text, stdout);
+    }
+
+    if(ppm)
+    {
+        write_ppm(tetris.display, ppm);
+    }
+
+    return 0;
+}
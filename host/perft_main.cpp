@@ -0,0 +1,120 @@
+#include "perft.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+
+/*
+* Reference counts of empty fields, seeded with reset(seed, 0).
+*/
+struct KnownCount
+{
+    uint32_t seed;
+    uint8_t depth;
+    uint64_t nodes;
+};
+
+static const KnownCount KNOWN[] = {
+    {1, 1, 34},
+    {1, 2, 598},
+    {1, 3, 21469},
+    {2, 3, 5309},
+    {3, 3, 10620},
+    {1, 4, 205345},
+};
+
+
+/*
+* Times one perft run and prints nodes and throughput.
+*/
+static uint64_t measure(Perft& perft, uint32_t seed, uint8_t depth)
+{
+    typedef std::chrono::steady_clock Clock;
+
+    static GameCore board;
+    Block::Shape shapes[Perft::MAX_DEPTH];
+
+    board.reset(seed, 0);
+    Perft::sequence(board, shapes, depth);
+
+    Clock::time_point start = Clock::now();
+    uint64_t nodes = perft.run(board, shapes, depth);
+    double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+    printf("seed %u depth %u nodes %llu generated %llu overflows %llu time %.3f s %.0f nodes/s\n", seed, depth,
+           (unsigned long long)nodes, (unsigned long long)perft.generated, (unsigned long long)perft.overflows,
+           seconds, nodes / seconds);
+
+    return nodes;
+}
+
+
+/*
+* usage: tetris_perft [--seed N] [--depth N] [--verify]
+*/
+int main(int argc, char** argv)
+{
+    uint32_t seed = 1;
+    uint8_t depth = 3;
+    bool verify = false;
+
+    for(int i = 1; i < argc; i++)
+    {
+        bool more = i + 1 < argc;
+
+        if(!strcmp(argv[i], "--seed") && more)
+        {
+            seed = strtoul(argv[++i], nullptr, 0);
+        }
+        else if(!strcmp(argv[i], "--depth") && more)
+        {
+            depth = atoi(argv[++i]);
+        }
+        else if(!strcmp(argv[i], "--verify"))
+        {
+            verify = true;
+        }
+        else
+        {
+            fprintf(stderr, "usage: %s [--seed N] [--depth N] [--verify]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    static Perft perft;
+
+    if(!verify)
+    {
+        if(depth < 1 || depth > Perft::MAX_DEPTH)
+        {
+            fprintf(stderr, "depth must be 1 to %u\n", Perft::MAX_DEPTH);
+            return 1;
+        }
+
+        measure(perft, seed, depth);
+        return 0;
+    }
+
+    int failures = 0;
+
+    for(const KnownCount& known : KNOWN)
+    {
+        uint64_t nodes = measure(perft, known.seed, known.depth);
+
+        if(nodes != known.nodes)
+        {
+            printf("MISMATCH expected %llu\n", (unsigned long long)known.nodes);
+            failures++;
+        }
+
+        if(perft.overflows)
+        {
+            printf("OVERFLOW placements were dropped\n");
+            failures++;
+        }
+    }
+
+    printf("%s\n", failures ? "FAIL" : "OK");
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,60 @@
+#include "host/platform_host.h"
+#include <condition_variable>
+#include <cstdio>
+#include <mutex>
+
+
+uint64_t HostPlatform::time_us;
+uint32_t HostPlatform::rng_state = 1;
+void (*HostPlatform::isr_table[HostPlatform::PIN_COUNT])();
+uint8_t HostPlatform::levels[HostPlatform::PIN_COUNT];
+uint64_t HostPlatform::wake_time = UINT64_MAX;
+const char* HostPlatform::storage_path;
+thread_local uint8_t HostPlatform::core_number = HostPlatform::NO_CORE;
+
+static std::mutex signal_mutex;
+static std::condition_variable signal_condition;
+static bool signalled;
+
+
+void HostPlatform::signal()
+{
+    std::lock_guard<std::mutex> lock(signal_mutex);
+    signalled = true;
+    signal_condition.notify_all();
+}
+
+
+void HostPlatform::wait_signal()
+{
+    std::unique_lock<std::mutex> lock(signal_mutex);
+    signal_condition.wait(lock, []() { return signalled; });
+    signalled = false;
+}
+
+
+void HostPlatform::store(const uint8_t* data, uint16_t size)
+{
+    FILE* file = storage_path ? fopen(storage_path, "wb") : nullptr;
+
+    if(file)
+    {
+        fwrite(data, 1, size, file);
+        fclose(file);
+    }
+}
+
+
+bool HostPlatform::load(uint8_t* data, uint16_t size)
+{
+    FILE* file = storage_path ? fopen(storage_path, "rb") : nullptr;
+
+    if(!file)
+    {
+        return false;
+    }
+
+    bool complete = fread(data, 1, size, file) == size;
+    fclose(file);
+    return complete;
+}
@@ -0,0 +1,109 @@
+#ifndef PLATFORM_HOST_H_
+#define PLATFORM_HOST_H_
+
+#include <chrono>
+#include <stdint.h>
+
+
+/**
+* Linux platform policy for headless runs.
+* The clock is virtual and only moves when the driver advances it, button
+* presses are injected by the driver and call the registered ISR directly.
+* press() is a tap, hold() and release() keep the pin level up in between.
+* wait() moves the clock forward, at most up to wake_time where the driver
+* injects its next input.
+*/
+class HostPlatform
+{
+  public:
+    static const uint8_t PIN_COUNT = 32;
+
+    // Advanced by the main thread only, the renderer reads it for statistics.
+    static uint64_t time_us;
+    static uint64_t wake_time;
+    static uint32_t rng_state;
+    static void (*isr_table[PIN_COUNT])();
+    static uint8_t levels[PIN_COUNT];
+    // File that stands in for flash, nullptr for none.
+    static const char* storage_path;
+    // Core the calling thread stands for, set by the driver, NO_CORE elsewhere.
+    static const uint8_t NO_CORE = 0xFF;
+    static thread_local uint8_t core_number;
+
+    static uint64_t now_us() { return __atomic_load_n(&time_us, __ATOMIC_ACQUIRE); }
+    static uint32_t millis() { return (uint32_t)(now_us() / 1000); }
+    static uint32_t micros() { return (uint32_t)now_us(); }
+    static void advance(uint32_t us) { __atomic_store_n(&time_us, now_us() + us, __ATOMIC_RELEASE); }
+
+    static uint32_t profile_us()
+    {
+        return (uint32_t)std::chrono::duration_cast<std::chrono::microseconds>(
+                   std::chrono::steady_clock::now().time_since_epoch())
+            .count();
+    }
+
+    static void wait(uint32_t timeout_us)
+    {
+        uint64_t now = now_us();
+        uint64_t until = now + timeout_us;
+        __atomic_store_n(&time_us, until < wake_time ? until : (wake_time > now ? wake_time : now), __ATOMIC_RELEASE);
+    }
+
+    // Latching wake up between threads, like SEV and WFE on the device.
+    static void signal();
+    static void wait_signal();
+    static uint8_t core() { return core_number; }
+
+    static void store(const uint8_t* data, uint16_t size);
+    static bool load(uint8_t* data, uint16_t size);
+
+    static void input_init(uint8_t pin, void (*isr)())
+    {
+        if(pin < PIN_COUNT)
+        {
+            isr_table[pin] = isr;
+        }
+    }
+
+    static uint8_t input_read(uint8_t pin) { return pin < PIN_COUNT ? levels[pin] : 0; }
+
+    static void press(uint8_t pin)
+    {
+        if(pin < PIN_COUNT && isr_table[pin])
+        {
+            isr_table[pin]();
+        }
+    }
+
+    static void hold(uint8_t pin)
+    {
+        if(pin < PIN_COUNT && !levels[pin])
+        {
+            levels[pin] = 1;
+            press(pin);
+        }
+    }
+
+    static void release(uint8_t pin)
+    {
+        if(pin < PIN_COUNT)
+        {
+            levels[pin] = 0;
+        }
+    }
+
+    /*
+    * Xorshift32, seeded by the driver for reproducible games.
+    */
+    static void seed(uint32_t s) { rng_state = s ? s : 1; }
+
+    static uint32_t random()
+    {
+        rng_state ^= rng_state << 13;
+        rng_state ^= rng_state >> 17;
+        rng_state ^= rng_state << 5;
+        return rng_state;
+    }
+};
+
+#endif
@@ -0,0 +1,107 @@
+#include "replay.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+
+static const char* const STATUS_NAMES[] = {"verified", "unfinished, not verified", "MISMATCH", "corrupt"};
+
+
+static void print_result(const char* name, const ReplayResult& result)
+{
+    printf("%s frame %u score %u level %u lines %u game_over %d hash %016llx\n", name, result.frame, result.score,
+           result.level, result.cleared_lines, result.game_over, (unsigned long long)result.hash);
+}
+
+
+/*
+* Plays a recording through the game rules as fast as possible and checks
+* the end state against the one recorded.
+*
+* usage: tetris_replay [--repeat N] recording.trpl
+*/
+int main(int argc, char** argv)
+{
+    typedef std::chrono::steady_clock Clock;
+
+    uint32_t repeat = 1;
+    const char* path = nullptr;
+
+    for(int i = 1; i < argc; i++)
+    {
+        if(!strcmp(argv[i], "--repeat") && i + 1 < argc)
+        {
+            repeat = strtoul(argv[++i], nullptr, 0);
+        }
+        else if(argv[i][0] != '-' && !path)
+        {
+            path = argv[i];
+        }
+        else
+        {
+            path = nullptr;
+            break;
+        }
+    }
+
+    if(!path || !repeat)
+    {
+        fprintf(stderr, "usage: %s [--repeat N] recording.trpl\n", argv[0]);
+        return 1;
+    }
+
+    FILE* file = fopen(path, "rb");
+
+    if(!file)
+    {
+        perror(path);
+        return 1;
+    }
+
+    std::vector<uint8_t> data;
+    uint8_t buffer[4096];
+    size_t length;
+
+    while((length = fread(buffer, 1, sizeof(buffer), file)))
+    {
+        data.insert(data.end(), buffer, buffer + length);
+    }
+
+    fclose(file);
+
+    static GameCore core;
+    ReplayResult expected;
+    Replay::Status status = Replay::CORRUPT;
+    uint64_t frames = 0;
+
+    Clock::time_point start = Clock::now();
+
+    for(uint32_t i = 0; i < repeat; i++)
+    {
+        status = Replay::play(data.data(), data.size(), core, expected);
+        frames += core.frame;
+    }
+
+    double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+    if(status == Replay::CORRUPT)
+    {
+        printf("%s: %s\n", path, STATUS_NAMES[status]);
+        return 1;
+    }
+
+    printf("seed %u start level %u, %zu bytes\n", core.seed, core.start_level, data.size());
+    print_result("replayed", Replay::result(core));
+
+    if(status != Replay::UNFINISHED)
+    {
+        print_result("recorded", expected);
+    }
+
+    printf("%s, %llu frames in %.3f s, %.0f frames/s\n", STATUS_NAMES[status], (unsigned long long)frames, seconds,
+           frames / seconds);
+
+    return status == Replay::MISMATCH;
+}
@@ -0,0 +1,87 @@
+#include "telemetry.h"
+#include <cstdio>
+#include <vector>
+
+
+/*
+* Turns a telemetry stream of tetris_host --telemetry or of TETRIS_TELEMETRY
+* on the device back into one readable line per game event.
+*
+* usage: tetris_telemetry stream.ttlm
+*/
+int main(int argc, char** argv)
+{
+    if(argc != 2)
+    {
+        fprintf(stderr, "usage: %s stream.ttlm\n", argv[0]);
+        return 1;
+    }
+
+    FILE* file = fopen(argv[1], "rb");
+
+    if(!file)
+    {
+        perror(argv[1]);
+        return 1;
+    }
+
+    std::vector<uint8_t> data;
+    uint8_t chunk[4096];
+    size_t length;
+
+    while((length = fread(chunk, 1, sizeof(chunk), file)))
+    {
+        data.insert(data.end(), chunk, chunk + length);
+    }
+
+    fclose(file);
+
+    if(data.size() < Telemetry::HEADER_SIZE || !Telemetry::check_header(data.data()))
+    {
+        fprintf(stderr, "%s: not a version %u telemetry stream\n", argv[1], Telemetry::VERSION);
+        return 1;
+    }
+
+    size_t position = Telemetry::HEADER_SIZE;
+
+    for(; position + Telemetry::RECORD_SIZE <= data.size(); position += Telemetry::RECORD_SIZE)
+    {
+        TelemetryRecord r;
+
+        if(!Telemetry::read_record(&data[position], r))
+        {
+            fprintf(stderr, "unknown record type %u at byte %zu\n", data[position], position);
+            return 1;
+        }
+
+        if(r.type == TelemetryRecord::DROPPED)
+        {
+            printf("%u records dropped\n", r.detail | r.lines << 8);
+            continue;
+        }
+
+        printf("frame %7u %8.2f s  %-13s ", r.frame, (double)r.frame / GameCore::FRAME_RATE, Telemetry::TYPE_NAMES[r.type]);
+
+        switch(r.type)
+        {
+            case TelemetryRecord::PIECE_LOCKED:
+                printf("row %2u ", r.detail);
+                break;
+            case TelemetryRecord::LINES_CLEARED:
+                printf("%u lines ", r.detail);
+                break;
+            default:
+                printf("level %u ", r.detail);
+                break;
+        }
+
+        printf("total lines %u score %u\n", r.lines, r.score);
+    }
+
+    if(position != data.size())
+    {
+        printf("stream ends within a record\n");
+    }
+
+    return 0;
+}
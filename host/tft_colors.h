@@ -0,0 +1,20 @@
+#ifndef TFT_COLORS_H_
+#define TFT_COLORS_H_
+
+/*
+* RGB565 values of the TFT_eSPI color names used by the game.
+*/
+#define TFT_BLACK       0x0000
+#define TFT_PURPLE      0x780F
+#define TFT_DARKGREY    0x7BEF
+#define TFT_BLUE        0x001F
+#define TFT_GREEN       0x07E0
+#define TFT_CYAN        0x07FF
+#define TFT_RED         0xF800
+#define TFT_YELLOW      0xFFE0
+#define TFT_WHITE       0xFFFF
+#define TFT_ORANGE      0xFDA0
+#define TFT_GREENYELLOW 0xB7E0
+#define TFT_SKYBLUE     0x867D
+
+#endif
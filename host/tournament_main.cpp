@@ -0,0 +1,284 @@
+#include "bot.h"
+#include "host/work_pool.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <numeric>
+#include <vector>
+
+
+/*
+* Outcome of one game.
+*/
+struct GameResult
+{
+    uint32_t seed;
+    uint8_t start_level;
+    uint32_t score;
+    uint16_t lines;
+    uint32_t pieces;
+    uint32_t frames;
+    // Level at the end, the top-out level if game_over is set.
+    uint8_t level;
+    bool game_over;
+};
+
+
+/*
+* Per worker transposition table, cleared for every game.
+*/
+struct Player
+{
+    std::vector<uint8_t> table_memory;
+    std::unique_ptr<TranspositionTable> table;
+};
+
+
+/*
+* Parses "a,b,c" into values, false on anything else.
+*/
+static bool parse_list(const char* text, std::vector<long>& values)
+{
+    values.clear();
+
+    while(*text)
+    {
+        char* end;
+        values.push_back(strtol(text, &end, 0));
+
+        if(end == text || (*end && *end != ','))
+        {
+            return false;
+        }
+
+        text = *end ? end + 1 : end;
+    }
+
+    return !values.empty();
+}
+
+
+/*
+* One complete game of the bot on the frame clock, no driver and no display.
+* The bot searches without time budget and starts with an empty table, so the
+* result only depends on seed, level and bot parameters.
+*/
+static GameResult play(Player& player, const Bot& params, uint32_t seed, uint8_t level, uint32_t max_frames)
+{
+    GameCore core;
+    // Too large for a worker stack.
+    std::unique_ptr<Autoplayer> owner(new Autoplayer);
+    Autoplayer& autoplayer = *owner;
+
+    autoplayer.synchronous = true;
+    autoplayer.bot.weight_height = params.weight_height;
+    autoplayer.bot.weight_lines = params.weight_lines;
+    autoplayer.bot.weight_holes = params.weight_holes;
+    autoplayer.bot.weight_bumpiness = params.weight_bumpiness;
+    autoplayer.bot.weight_max_height = params.weight_max_height;
+    autoplayer.bot.beam_width = params.beam_width;
+    autoplayer.bot.depth = params.depth;
+    autoplayer.bot.table = player.table.get();
+
+    if(player.table)
+    {
+        player.table->clear();
+    }
+
+    core.reset(seed, level);
+
+    while(!core.game_over && core.frame < max_frames)
+    {
+        core.step(autoplayer.inputs(core));
+    }
+
+    GameResult result;
+    result.seed = seed;
+    result.start_level = core.start_level;
+    result.score = core.score;
+    result.lines = core.cleared_lines;
+    result.pieces = core.pieces;
+    result.frames = core.frame;
+    result.level = core.level;
+    result.game_over = core.game_over;
+    return result;
+}
+
+
+/*
+* Bot self-play over a set of seeds and start levels, every game on its own
+* worker of a work stealing pool. Games are independent and collected by
+* index, so the summary does not depend on the thread count.
+*
+* usage: tetris_tournament [--seeds N] [--first-seed N] [--levels a,b,..] [--minutes N] [--threads N]
+*                          [--tt-mb N] [--beam N] [--depth N] [--weights height,lines,holes,bumpiness,max_height] [--list]
+*/
+int main(int argc, char** argv)
+{
+    typedef std::chrono::steady_clock Clock;
+
+    uint32_t seeds = 64;
+    uint32_t first_seed = 1;
+    std::vector<long> levels = {6};
+    uint32_t minutes = 10;
+    unsigned threads = std::thread::hardware_concurrency();
+    uint32_t table_mb = 4;
+    bool list = false;
+    Bot params;
+    bool usage = false;
+
+    for(int i = 1; i < argc && !usage; i++)
+    {
+        bool more = i + 1 < argc;
+        std::vector<long> values;
+
+        if(!strcmp(argv[i], "--seeds") && more)
+        {
+            seeds = strtoul(argv[++i], nullptr, 0);
+        }
+        else if(!strcmp(argv[i], "--first-seed") && more)
+        {
+            first_seed = strtoul(argv[++i], nullptr, 0);
+        }
+        else if(!strcmp(argv[i], "--levels") && more)
+        {
+            usage = !parse_list(argv[++i], levels);
+        }
+        else if(!strcmp(argv[i], "--minutes") && more)
+        {
+            minutes = strtoul(argv[++i], nullptr, 0);
+        }
+        else if(!strcmp(argv[i], "--threads") && more)
+        {
+            threads = strtoul(argv[++i], nullptr, 0);
+        }
+        else if(!strcmp(argv[i], "--tt-mb") && more)
+        {
+            table_mb = strtoul(argv[++i], nullptr, 0);
+        }
+        else if(!strcmp(argv[i], "--beam") && more)
+        {
+            params.beam_width = std::min<unsigned long>(strtoul(argv[++i], nullptr, 0), Bot::MAX_BEAM);
+        }
+        else if(!strcmp(argv[i], "--depth") && more)
+        {
+            params.depth = std::min<unsigned long>(strtoul(argv[++i], nullptr, 0), 1 + GameCore::PREVIEW_LENGTH);
+        }
+        else if(!strcmp(argv[i], "--weights") && more && parse_list(argv[++i], values) && values.size() == 5)
+        {
+            params.weight_height = values[0];
+            params.weight_lines = values[1];
+            params.weight_holes = values[2];
+            params.weight_bumpiness = values[3];
+            params.weight_max_height = values[4];
+        }
+        else if(!strcmp(argv[i], "--list"))
+        {
+            list = true;
+        }
+        else
+        {
+            usage = true;
+        }
+    }
+
+    if(usage || !seeds || !params.beam_width || !params.depth)
+    {
+        fprintf(stderr,
+                "usage: %s [--seeds N] [--first-seed N] [--levels a,b,..] [--minutes N] [--threads N]\n"
+                "       [--tt-mb N] [--beam N] [--depth N] [--weights height,lines,holes,bumpiness,max_height] [--list]\n",
+                argv[0]);
+        return 1;
+    }
+
+    uint32_t games = seeds * levels.size();
+    uint32_t max_frames = minutes * 60 * GameCore::FRAME_RATE;
+    WorkPool pool(threads);
+    std::vector<std::unique_ptr<Player>> players(pool.size());
+    std::vector<GameResult> results(games);
+
+    for(std::unique_ptr<Player>& player : players)
+    {
+        player.reset(new Player);
+
+        if(table_mb)
+        {
+            player->table_memory.resize(table_mb << 20);
+            player->table.reset(new TranspositionTable(player->table_memory.data(), player->table_memory.size()));
+        }
+    }
+
+    printf("%u games, %u seeds from %u, beam %u depth %u, weights %d,%d,%d,%d,%d, %u threads\n", games, seeds,
+           first_seed, params.beam_width, params.depth, params.weight_height, params.weight_lines, params.weight_holes,
+           params.weight_bumpiness, params.weight_max_height, pool.size());
+
+    Clock::time_point start = Clock::now();
+
+    pool.run(games,
+             [&](uint32_t game, unsigned worker)
+             {
+                 results[game] = play(*players[worker], params, first_seed + game % seeds, levels[game / seeds], max_frames);
+             });
+
+    double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+    uint64_t total_pieces = 0;
+    uint64_t total_frames = 0;
+
+    for(uint32_t level = 0; level < levels.size(); level++)
+    {
+        const GameResult* first = &results[level * seeds];
+        std::vector<uint32_t> scores;
+        uint64_t lines = 0;
+        uint64_t pieces = 0;
+        uint64_t frames = 0;
+        uint64_t top_out_level = 0;
+        uint32_t top_outs = 0;
+
+        for(uint32_t i = 0; i < seeds; i++)
+        {
+            const GameResult& r = first[i];
+
+            if(list)
+            {
+                printf("seed %u level %u score %u lines %u pieces %u frames %u end level %u game_over %d\n", r.seed,
+                       r.start_level, r.score, r.lines, r.pieces, r.frames, r.level, r.game_over);
+            }
+
+            scores.push_back(r.score);
+            lines += r.lines;
+            pieces += r.pieces;
+            frames += r.frames;
+
+            if(r.game_over)
+            {
+                top_outs++;
+                top_out_level += r.level;
+            }
+        }
+
+        std::sort(scores.begin(), scores.end());
+        total_pieces += pieces;
+        total_frames += frames;
+
+        printf("level %ld: score mean %.0f median %u min %u max %u, lines mean %.1f, %.2f pieces per game second, ",
+               levels[level], (double)std::accumulate(scores.begin(), scores.end(), 0.0) / seeds, scores[seeds / 2],
+               scores.front(), scores.back(), (double)lines / seeds, frames ? pieces * GameCore::FRAME_RATE / (double)frames : 0.0);
+
+        if(top_outs)
+        {
+            printf("%u top outs at level %.1f on average\n", top_outs, (double)top_out_level / top_outs);
+        }
+        else
+        {
+            printf("no top outs\n");
+        }
+    }
+
+    printf("%.1f s, %.0f pieces/s, %.0f frames/s\n", seconds, total_pieces / seconds, total_frames / seconds);
+
+    return 0;
+}
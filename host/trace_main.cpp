@@ -0,0 +1,123 @@
+#include "trace.h"
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+
+/*
+* Converts a span dump of tetris_host --trace or of TETRIS_TRACE on the
+* device into Chrome trace JSON, for chrome://tracing or ui.perfetto.dev.
+* One thread per core, timestamps start at zero. The 32 bit microsecond
+* clock wraps after 71 minutes, each core's spans are unwrapped in order.
+*
+* usage: tetris_trace dump.ttrc out.json
+*/
+int main(int argc, char** argv)
+{
+    if(argc != 3)
+    {
+        fprintf(stderr, "usage: %s dump.ttrc out.json\n", argv[0]);
+        return 1;
+    }
+
+    FILE* file = fopen(argv[1], "rb");
+
+    if(!file)
+    {
+        perror(argv[1]);
+        return 1;
+    }
+
+    std::vector<uint8_t> data;
+    uint8_t chunk[4096];
+    size_t length;
+
+    while((length = fread(chunk, 1, sizeof(chunk), file)))
+    {
+        data.insert(data.end(), chunk, chunk + length);
+    }
+
+    fclose(file);
+
+    uint8_t header[Trace::HEADER_SIZE];
+    Trace::write_header(header);
+
+    if(data.size() < Trace::HEADER_SIZE || memcmp(data.data(), header, Trace::HEADER_SIZE))
+    {
+        fprintf(stderr, "%s: not a version %u trace dump\n", argv[1], Trace::VERSION);
+        return 1;
+    }
+
+    FILE* out = fopen(argv[2], "w");
+
+    if(!out)
+    {
+        perror(argv[2]);
+        return 1;
+    }
+
+    struct Span
+    {
+        int64_t time;
+        uint32_t duration;
+        uint8_t name;
+        uint8_t core;
+    };
+
+    std::vector<Span> spans;
+    int64_t last[Trace::CORES] = {};
+    bool seen[Trace::CORES] = {};
+    int64_t origin = INT64_MAX;
+    uint32_t skipped = 0;
+
+    for(size_t i = Trace::HEADER_SIZE; i + Trace::RECORD_SIZE <= data.size(); i += Trace::RECORD_SIZE)
+    {
+        const uint8_t* p = &data[i];
+        uint32_t start = p[0] | p[1] << 8 | p[2] << 16 | (uint32_t)p[3] << 24;
+        uint32_t duration = p[4] | p[5] << 8 | p[6] << 16 | (uint32_t)p[7] << 24;
+        uint8_t name = p[8];
+        uint8_t core = p[9];
+
+        if(name >= Trace::NAME_COUNT || core >= Trace::CORES)
+        {
+            skipped++;
+            continue;
+        }
+
+        // Signed distance to the previous span of the core, nested spans end first.
+        int64_t time = seen[core] ? last[core] + (int32_t)(start - (uint32_t)last[core]) : start;
+        last[core] = time;
+        seen[core] = true;
+        origin = time < origin ? time : origin;
+        spans.push_back({time, duration, name, core});
+    }
+
+    fprintf(out, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+
+    for(uint8_t core = 0; core < Trace::CORES; core++)
+    {
+        fprintf(out, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":\"core %u\"}},\n", core,
+                core);
+    }
+
+    for(const Span& span : spans)
+    {
+        fprintf(out, "{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%lld,\"dur\":%u},\n",
+                Trace::NAMES[span.name], span.core, (long long)(span.time - origin), span.duration);
+    }
+
+    // Metadata event without trailing comma closes the list.
+    fprintf(out, "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"args\":{\"name\":\"tetris\"}}\n]}\n");
+    fclose(out);
+
+    printf("%zu spans", spans.size());
+
+    if(skipped)
+    {
+        printf(", %u unknown records skipped", skipped);
+    }
+
+    printf("\n");
+    return 0;
+}
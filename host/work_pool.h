@@ -0,0 +1,170 @@
+#ifndef WORK_POOL_H_
+#define WORK_POOL_H_
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <stdint.h>
+#include <thread>
+#include <vector>
+
+
+/**
+* Work stealing thread pool for parallel loops on the host.
+* Every worker owns a task deque, takes from its front and steals from the
+* back of the others once it runs dry. The calling thread works as worker 0.
+*/
+class WorkPool
+{
+  public:
+    explicit WorkPool(unsigned threads = std::thread::hardware_concurrency())
+    {
+        unsigned count = threads ? threads : 1;
+
+        workers = std::vector<Worker>(count);
+
+        for(unsigned i = 1; i < count; i++)
+        {
+            threads_.emplace_back([this, i]() { worker_loop(i); });
+        }
+    }
+
+    ~WorkPool()
+    {
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            stopping = true;
+            generation++;
+        }
+
+        wake.notify_all();
+
+        for(std::thread& t : threads_)
+        {
+            t.join();
+        }
+    }
+
+    unsigned size() const { return workers.size(); }
+
+    /*
+    * Calls fn(index, worker) for every index in [0, count) and returns once
+    * all calls finished. Indices are dealt round robin to the workers.
+    */
+    void run(uint32_t count, std::function<void(uint32_t, unsigned)> fn)
+    {
+        if(!count)
+        {
+            return;
+        }
+
+        // The job is published before any task, a worker holding a task
+        // always sees the matching job.
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            job = fn;
+            remaining = count;
+            generation++;
+        }
+
+        for(uint32_t i = 0; i < count; i++)
+        {
+            Worker& w = workers[i % workers.size()];
+            std::lock_guard<std::mutex> guard(w.lock);
+            w.tasks.push_back(i);
+        }
+
+        wake.notify_all();
+        work(0);
+
+        std::unique_lock<std::mutex> guard(lock);
+        done.wait(guard, [this]() { return remaining == 0; });
+    }
+
+  private:
+    struct Worker
+    {
+        std::mutex lock;
+        std::deque<uint32_t> tasks;
+    };
+
+    std::vector<Worker> workers;
+    std::vector<std::thread> threads_;
+    std::mutex lock;
+    std::condition_variable wake;
+    std::condition_variable done;
+    std::function<void(uint32_t, unsigned)> job;
+    uint64_t generation = 0;
+    uint32_t remaining = 0;
+    bool stopping = false;
+
+    bool take(unsigned self, uint32_t& task)
+    {
+        for(unsigned i = 0; i < workers.size(); i++)
+        {
+            Worker& w = workers[(self + i) % workers.size()];
+            std::lock_guard<std::mutex> guard(w.lock);
+
+            if(w.tasks.empty())
+            {
+                continue;
+            }
+
+            if(i == 0)
+            {
+                task = w.tasks.front();
+                w.tasks.pop_front();
+            }
+            else
+            {
+                task = w.tasks.back();
+                w.tasks.pop_back();
+            }
+
+            return true;
+        }
+
+        return false;
+    }
+
+    void work(unsigned self)
+    {
+        uint32_t task;
+
+        while(take(self, task))
+        {
+            job(task, self);
+
+            std::lock_guard<std::mutex> guard(lock);
+
+            if(--remaining == 0)
+            {
+                done.notify_all();
+            }
+        }
+    }
+
+    void worker_loop(unsigned self)
+    {
+        uint64_t seen = 0;
+
+        while(true)
+        {
+            {
+                std::unique_lock<std::mutex> guard(lock);
+                wake.wait(guard, [&]() { return generation != seen; });
+                seen = generation;
+
+                if(stopping)
+                {
+                    return;
+                }
+            }
+
+            work(self);
+        }
+    }
+};
+
+#endif
@@ -0,0 +1,126 @@
+#include "input_queue.h"
+#include <stdint.h>
+
+
+InputQueue::InputQueue()
+{
+    dropped = 0;
+    handled = 0;
+    latency_max = 0;
+    latency_sum = 0;
+    drained_time = 0;
+
+    for(uint8_t i = 0; i < BUTTON_COUNT; i++)
+    {
+        state[i] = READY;
+        last_edge[i] = 0;
+    }
+}
+
+
+/*
+ * Rising edge of a button, called from its ISR.
+ * A ready button queues a press and starts settling, every further edge
+ * restarts the quiet time so contact bounce never gets through.
+ */
+void InputQueue::edge(uint8_t button, uint32_t now)
+{
+    if(state[button] == SETTLING && now - last_edge[button] < DEBOUNCE_US)
+    {
+        last_edge[button] = now;
+        return;
+    }
+
+    state[button] = SETTLING;
+    last_edge[button] = now;
+
+    InputEvent event = {now, (uint8_t)(1 << button)};
+
+    if(!events.push(event))
+    {
+        dropped++;
+    }
+}
+
+
+/*
+ * Inputs of the next frame.
+ * Presses at least min_age old are taken in order until a button repeats,
+ * the repeat and everything after it stay queued for the following frames.
+ */
+FrameInputs InputQueue::drain(uint32_t now, uint32_t min_age)
+{
+    FrameInputs inputs = 0;
+    const InputEvent* event;
+
+    while((event = events.peek()) && !(inputs & event->input) && now - event->time >= min_age)
+    {
+        uint32_t latency = now - event->time;
+
+        if(!inputs)
+        {
+            drained_time = event->time;
+        }
+
+        inputs |= event->input;
+        handled++;
+        latency_sum += latency;
+        latency_max = latency > latency_max ? latency : latency_max;
+
+        events.release();
+    }
+
+    return inputs;
+}
+
+
+AutoRepeat::AutoRepeat()
+{
+    das_frames = 10;
+    arr_frames = 2;
+
+    for(uint8_t i = 0; i < InputQueue::BUTTON_COUNT; i++)
+    {
+        held_frames[i] = 0;
+    }
+}
+
+
+/*
+ * Repeated inputs of one frame, held is the bitmask of buttons that are down.
+ */
+FrameInputs AutoRepeat::update(uint8_t held)
+{
+    FrameInputs inputs = 0;
+
+    for(uint8_t i = 0; i < InputQueue::BUTTON_COUNT; i++)
+    {
+        uint8_t input = 1 << i;
+
+        if(!(held & input & REPEATING))
+        {
+            held_frames[i] = 0;
+            continue;
+        }
+
+        if(held_frames[i] < 255)
+        {
+            held_frames[i]++;
+        }
+
+        uint8_t repeat_frames = arr_frames ? arr_frames : 1;
+
+        if(held_frames[i] >= das_frames && (held_frames[i] - das_frames) % repeat_frames == 0)
+        {
+            inputs |= input;
+        }
+
+        // Keeps repeating past the saturation point.
+        if(held_frames[i] == 255)
+        {
+            held_frames[i] = 255 - repeat_frames;
+        }
+    }
+
+    return inputs;
+}
@@ -0,0 +1,83 @@
+#ifndef INPUT_QUEUE_H_
+#define INPUT_QUEUE_H_
+
+#include "game_core.h"
+#include "spsc_ring.h"
+#include <stdint.h>
+
+
+/**
+* Button press with the time its interrupt fired.
+*/
+struct InputEvent
+{
+    uint32_t time;
+    uint8_t input;
+};
+
+
+/**
+* Interrupt safe queue of debounced button presses.
+* Every button runs its own debounce state machine in the ISR, accepted
+* presses are queued with a microsecond timestamp and drained by the game
+* loop once per frame.
+*/
+class InputQueue
+{
+  public:
+    static const uint8_t BUTTON_COUNT = 4;
+    static const uint8_t SIZE = 32;
+    // Quiet time after the last edge before a button accepts the next press.
+    static const uint32_t DEBOUNCE_US = 50000;
+
+    enum DebounceState
+    {
+        READY,
+        SETTLING
+    };
+
+    // Presses lost because the queue was full.
+    uint32_t dropped;
+
+    // Time from interrupt to the frame that applied it, in microseconds.
+    uint32_t handled;
+    uint32_t latency_max;
+    uint64_t latency_sum;
+    // Interrupt time of the first press the last drain() took.
+    uint32_t drained_time;
+
+    InputQueue();
+    void edge(uint8_t button, uint32_t now);
+    FrameInputs drain(uint32_t now, uint32_t min_age);
+    bool pending() { return events.peek() != nullptr; }
+
+  private:
+    SpscRing<InputEvent, SIZE> events;
+    DebounceState state[BUTTON_COUNT];
+    uint32_t last_edge[BUTTON_COUNT];
+};
+
+
+
+/**
+* Delayed auto shift for held move buttons.
+* The first shift comes from the press itself, a button held for das_frames
+* repeats every arr_frames after that.
+*/
+class AutoRepeat
+{
+  public:
+    static const uint8_t REPEATING = GameCore::MOVE_LEFT | GameCore::MOVE_RIGHT;
+
+    uint8_t das_frames;
+    uint8_t arr_frames;
+
+    AutoRepeat();
+    FrameInputs update(uint8_t held);
+
+  private:
+    // Frames each button has been held, saturating.
+    uint8_t held_frames[InputQueue::BUTTON_COUNT];
+};
+
+#endif
@@ -1,7 +1,144 @@
 #include "tetris.h"
+#include "bench.h"
 
+// Set to 1 to print hot path timings over Serial instead of playing.
+#define TETRIS_BENCH 0
+// Set to 1 to let the bot play, it searches on the second core.
+// The second core renders otherwise.
+#define TETRIS_AUTOPLAY 0
+// Set to 1 to stream a replay of the game over Serial, see "replay.h".
+#define TETRIS_RECORD 0
+// Set to 1 to print frame time and latency statistics over Serial.
+#define TETRIS_STATS 0
+// Time between two statistics reports.
+static const uint32_t STATS_INTERVAL_MS = 5000;
+// Set to 1 to stream game events over Serial, see tetris_telemetry.
+#define TETRIS_TELEMETRY 0
+// TETRIS_TRACE in "trace.h" streams trace spans over Serial, see tetris_trace.
+// Serial output of all these modes is only readable one mode at a time.
 
-void setup(void) {}
+// Game of the first core, drawn by the second one once it exists, without
+// the bot, or only reported on otherwise.
+static Tetris* volatile game;
 
+#if TETRIS_RECORD
+static ReplayRecorder recorder;
+#endif
 
-void loop() { Tetris tetris; }
\ No newline at end of file
+#if TETRIS_TELEMETRY
+static Telemetry telemetry;
+#endif
+
+
+#if TETRIS_AUTOPLAY
+static Autoplayer autoplayer;
+// Transposition table budget of the bot in SRAM.
+static uint8_t table_memory[16 * 1024];
+static TranspositionTable table(table_memory, sizeof(table_memory));
+#endif
+
+
+void setup(void)
+{
+#if TETRIS_BENCH || TETRIS_RECORD || TETRIS_STATS || TETRIS_TRACE || TETRIS_TELEMETRY
+    Serial.begin(115200);
+#endif
+}
+
+
+void loop()
+{
+#if TETRIS_BENCH
+    Bench::report_cycles();
+    delay(5000);
+#else
+    static Tetris tetris;
+
+    // A game saved at a pause continues paused, the pause chord goes on.
+    if(tetris.resume())
+    {
+        tetris.pause(true);
+    }
+
+#if TETRIS_RECORD
+    uint8_t header[Replay::HEADER_SIZE];
+    Serial.write(header, Replay::write_header(header, tetris.core));
+    tetris.recorder = &recorder;
+#endif
+
+#if TETRIS_TELEMETRY
+    uint8_t telemetry_header[Telemetry::HEADER_SIZE];
+    Serial.write(telemetry_header, Telemetry::write_header(telemetry_header));
+    tetris.telemetry = &telemetry;
+#endif
+
+#if TETRIS_TRACE
+    uint8_t trace_header[Trace::HEADER_SIZE];
+    Serial.write(trace_header, Trace::write_header(trace_header));
+#endif
+
+#if TETRIS_AUTOPLAY
+    autoplayer.bot.table = &table;
+    tetris.autoplayer = &autoplayer;
+#else
+    tetris.pipelined = true;
+#endif
+
+    __sync_synchronize();
+    game = &tetris;
+
+    tetris.run();
+#endif
+}
+
+
+void setup1(void) {}
+
+
+void loop1()
+{
+#if TETRIS_RECORD
+    // The recording has no end, the host tool plays it back up to the last event.
+    uint8_t bytes[64];
+    Serial.write(bytes, recorder.flush(bytes, sizeof(bytes)));
+#endif
+
+#if TETRIS_TELEMETRY
+    // Only what the USB buffer takes, records wait in the ring or drop otherwise.
+    uint8_t records[Telemetry::RECORD_SIZE * 4];
+    int room = Serial.availableForWrite();
+    Serial.write(records, telemetry.flush(records, room < (int)sizeof(records) ? room : sizeof(records)));
+#endif
+
+#if TETRIS_TRACE
+    uint8_t spans[Trace::RECORD_SIZE * 6];
+    Serial.write(spans, Trace::flush(spans, sizeof(spans)));
+#endif
+
+#if TETRIS_STATS
+    static uint32_t last_report;
+
+    if(game && millis() - last_report >= STATS_INTERVAL_MS)
+    {
+        // Skipped rather than blocking the renderer while the USB host is not reading.
+        FrameStats stats = game->stats;
+        char text[384];
+        uint16_t length = stats.format(text, sizeof(text));
+
+        if(Serial.availableForWrite() >= length)
+        {
+            Serial.write((const uint8_t*)text, length);
+            last_report = millis();
+        }
+    }
+#endif
+
+#if TETRIS_AUTOPLAY
+    autoplayer.think();
+#else
+    if(game && !game->render())
+    {
+        Platform::wait_signal();
+    }
+#endif
+}
@@ -0,0 +1,213 @@
+#include "movegen.h"
+#include <cstring>
+#include <stdint.h>
+
+
+/*
+ * Index of a block state in the search tables.
+ */
+uint16_t MoveGenerator::state(int8_t x, int8_t y, uint8_t rotation, uint8_t phase)
+{
+    return (((uint16_t)phase * 4 + rotation) * STATE_HEIGHT + (y + STATE_OFFSET)) * STATE_WIDTH + (x + STATE_OFFSET);
+}
+
+
+/*
+ * Marks a state as reached, returns false if it was reached before.
+ */
+bool MoveGenerator::visit(uint16_t s, uint16_t from, Action a)
+{
+    if(visited[s >> 5] & (1u << (s & 31)))
+    {
+        return false;
+    }
+
+    visited[s >> 5] |= 1u << (s & 31);
+    parent[s] = from;
+    action[s] = a;
+    return true;
+}
+
+
+/*
+ * Records a lock position unless an equal set of squares is already known.
+ */
+void MoveGenerator::add_placement(Block::Shape shape, int8_t x, int8_t y, uint8_t rotation, uint16_t s)
+{
+    const PieceState& piece = Block::PIECES.states[shape][rotation];
+    int8_t top = y + piece.top;
+    uint64_t key = (uint8_t)top;
+
+    for(uint8_t row = 0; row < piece.height; row++)
+    {
+        uint64_t bits = (piece.mask >> (row * 4)) & 0xF;
+        key |= bits << (8 + row * GameCore::SQUARES_PER_ROW + x + piece.left);
+    }
+
+    for(uint8_t i = 0; i < count; i++)
+    {
+        if(placements[i].key == key)
+        {
+            return;
+        }
+    }
+
+    if(count == MAX_PLACEMENTS)
+    {
+        overflows++;
+        return;
+    }
+
+    Placement& p = placements[count];
+    uint8_t length = 0;
+
+    for(uint16_t node = s; action[node] != 0xFF; node = parent[node])
+    {
+        if(++length > Placement::MAX_PATH)
+        {
+            overflows++;
+            return;
+        }
+    }
+
+    p.x = x;
+    p.y = y;
+    p.rotation = rotation;
+    p.key = key;
+    p.path_length = length;
+
+    for(uint16_t node = s; action[node] != 0xFF; node = parent[node])
+    {
+        p.path[--length] = action[node];
+    }
+
+    count++;
+}
+
+
+/*
+ * Applies one input to a block state, false if the game would refuse it.
+ */
+bool MoveGenerator::apply(const GameCore& core, Block::Shape shape, int8_t& x, int8_t& y, uint8_t& rotation, uint8_t a)
+{
+    switch(a)
+    {
+        case LEFT:
+            return core.fits(shape, rotation, ++x, y);
+        case RIGHT:
+            return core.fits(shape, rotation, --x, y);
+        case ROTATE_LEFT:
+        case ROTATE_RIGHT:
+        {
+            Block::Direction d = a == ROTATE_LEFT ? Block::LEFT : Block::RIGHT;
+            int8_t k = core.rotation_kick(shape, rotation, d, x, y);
+
+            if(k < 0)
+            {
+                return false;
+            }
+
+            x += Block::PIECES.kicks[shape][rotation][d][k].x;
+            y += Block::PIECES.kicks[shape][rotation][d][k].y;
+            rotation = Block::turn(shape, rotation, d);
+            return true;
+        }
+        default:
+            return true;
+    }
+}
+
+
+/*
+ * Finds all lock positions reachable from the start block.
+ * Returns the number of distinct placements.
+ */
+uint8_t MoveGenerator::generate(const GameCore& core, const Block& start)
+{
+    memset(visited, 0, sizeof(visited));
+    count = 0;
+    overflows = 0;
+
+    // Timed search: one input or a wait per frame, gravity after the last frame of a row.
+    uint8_t frames = GameCore::GRAVITY.frames[core.level];
+    bool timed = frames <= TIMED_GRAVITY;
+
+    uint16_t head = 0;
+    uint16_t tail = 0;
+    uint16_t first = state(start.center.x, start.center.y, start.rotation, timed ? core.gravity_counter : 0);
+
+    visit(first, first, LEFT);
+    action[first] = 0xFF;
+    queue[tail++] = first;
+
+    while(head != tail)
+    {
+        uint16_t s = queue[head++];
+        uint8_t phase = s / (4 * STATE_WIDTH * STATE_HEIGHT);
+        uint8_t rotation = s / (STATE_WIDTH * STATE_HEIGHT) % 4;
+        int8_t x = s % STATE_WIDTH - STATE_OFFSET;
+        int8_t y = s / STATE_WIDTH % STATE_HEIGHT - STATE_OFFSET;
+
+        if(!timed || phase < frames)
+        {
+            uint8_t next_phase = timed ? phase + 1 : 0;
+
+            for(uint8_t a = LEFT; a <= WAIT; a++)
+            {
+                if(a == DOWN || (a == WAIT && !timed))
+                {
+                    continue;
+                }
+
+                int8_t next_x = x;
+                int8_t next_y = y;
+                uint8_t next_rotation = rotation;
+
+                if(!apply(core, start.shape, next_x, next_y, next_rotation, a))
+                {
+                    continue;
+                }
+
+                uint16_t next = state(next_x, next_y, next_rotation, next_phase);
+
+                if(visit(next, s, Action(a)))
+                {
+                    queue[tail++] = next;
+                }
+            }
+
+            if(timed)
+            {
+                continue;
+            }
+        }
+
+        // Gravity last, so paths prefer moving while the block is high.
+        if(core.grounded(start.shape, rotation, x, y))
+        {
+            add_placement(start.shape, x, y, rotation, s);
+        }
+        else
+        {
+            uint16_t next = state(x, y + 1, rotation, 0);
+
+            if(visit(next, s, DOWN))
+            {
+                queue[tail++] = next;
+            }
+        }
+    }
+
+    return count;
+}
+
+
+/*
+ * Moves a block of the generated shape to the given placement.
+ */
+void MoveGenerator::place(Block& b, const Placement& p)
+{
+    b.set_state(p.rotation);
+    b.center.x = p.x;
+    b.center.y = p.y;
+}
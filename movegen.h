@@ -0,0 +1,81 @@
+#ifndef MOVEGEN_H_
+#define MOVEGEN_H_
+
+#include "game_core.h"
+#include <stdint.h>
+
+
+/**
+* Reachable lock position of a block together with the shortest input path.
+*/
+class Placement
+{
+  public:
+    static const uint8_t MAX_PATH = 40;
+
+    int8_t x;
+    int8_t y;
+    uint8_t rotation;
+    uint8_t path_length;
+    // Occupied rows of the locked block, used to drop equivalent states.
+    uint64_t key;
+    uint8_t path[MAX_PATH];
+};
+
+
+/**
+* Enumerates every lock position of a block on the current field.
+* Breadth first search over (x, y, rotation) with the same moves and checks
+* as the game, so tucks and spins under overhangs are found as well. Gravity
+* is modelled as a DOWN action. At slow gravity the path does not account for
+* timing, from TIMED_GRAVITY frames per row down every state also carries the
+* frame within its row, so only placements that one input per frame can reach
+* in time are found.
+*/
+class MoveGenerator
+{
+  public:
+    enum Action : uint8_t
+    {
+        LEFT,
+        RIGHT,
+        ROTATE_LEFT,
+        ROTATE_RIGHT,
+        DOWN,
+        // One frame without input, only used with timed gravity.
+        WAIT
+    };
+
+    static const uint8_t MAX_PLACEMENTS = 128;
+
+    // State grid, centers outside of it can not hold a valid block.
+    static const uint8_t STATE_OFFSET = 3;
+    static const uint8_t STATE_WIDTH = 16;
+    static const uint8_t STATE_HEIGHT = 18;
+    static const uint8_t TIMED_GRAVITY = 2;
+    // Frames within a row, the last phase is gravity about to move the block.
+    static const uint8_t PHASES = TIMED_GRAVITY + 1;
+    static const uint16_t STATE_COUNT = PHASES * 4 * STATE_HEIGHT * STATE_WIDTH;
+
+    Placement placements[MAX_PLACEMENTS];
+    uint8_t count;
+    // Placements of the last search that were dropped, beyond MAX_PLACEMENTS
+    // or with a path longer than Placement::MAX_PATH.
+    uint8_t overflows;
+
+    uint8_t generate(const GameCore& core, const Block& start);
+    static void place(Block& b, const Placement& p);
+
+  private:
+    uint32_t visited[STATE_COUNT / 32];
+    uint16_t parent[STATE_COUNT];
+    uint8_t action[STATE_COUNT];
+    uint16_t queue[STATE_COUNT];
+
+    static uint16_t state(int8_t x, int8_t y, uint8_t rotation, uint8_t phase);
+    static bool apply(const GameCore& core, Block::Shape shape, int8_t& x, int8_t& y, uint8_t& rotation, uint8_t a);
+    bool visit(uint16_t s, uint16_t from, Action a);
+    void add_placement(Block::Shape shape, int8_t x, int8_t y, uint8_t rotation, uint16_t s);
+};
+
+#endif
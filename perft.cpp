@@ -0,0 +1,81 @@
+#include "perft.h"
+#include <stdint.h>
+
+
+/*
+ * Block sequence of a game, the current block followed by what the seeded
+ * generator spawns next.
+ */
+void Perft::sequence(const GameCore& board, Block::Shape* shapes, uint8_t count)
+{
+    GameCore game(board);
+
+    for(uint8_t i = 0; i < count; i++)
+    {
+        shapes[i] = game.block.shape;
+        game.spawn_block();
+    }
+}
+
+
+/*
+ * Leaf count at the given depth, placements that end the game are neither
+ * leaves nor have children.
+ */
+uint64_t Perft::run(const GameCore& board, const Block::Shape* sequence, uint8_t depth)
+{
+    generated = 0;
+    overflows = 0;
+
+    if(depth > MAX_DEPTH)
+    {
+        return 0;
+    }
+
+    return count(board, sequence, depth);
+}
+
+
+uint64_t Perft::count(const GameCore& board, const Block::Shape* sequence, uint8_t depth)
+{
+    if(!depth)
+    {
+        return 1;
+    }
+
+    MoveGenerator& moves = generators[depth - 1];
+    GameCore node(board);
+
+    node.block.init(sequence[0]);
+
+    uint8_t placements = moves.generate(node, node.block);
+    generated++;
+    overflows += moves.overflows;
+
+    uint64_t total = 0;
+
+    for(uint8_t i = 0; i < placements; i++)
+    {
+        const Placement& p = moves.placements[i];
+
+        // Locking in the spawn row ends the game, at every depth.
+        if(GameCore::tops_out(p.y))
+        {
+            continue;
+        }
+
+        // Bulk counting, the last level needs no board updates.
+        if(depth == 1)
+        {
+            total++;
+            continue;
+        }
+
+        GameCore child(node);
+        MoveGenerator::place(child.block, p);
+        child.finish_block();
+        total += count(child, sequence + 1, depth - 1);
+    }
+
+    return total;
+}
@@ -0,0 +1,32 @@
+#ifndef PERFT_H_
+#define PERFT_H_
+
+#include "game_core.h"
+#include "movegen.h"
+#include <stdint.h>
+
+
+/**
+* Move generation counter in the style of chess perft.
+* Counts the distinct placement sequences of a fixed block sequence down to
+* a given depth, running the real collision and line clear code on the way.
+*/
+class Perft
+{
+  public:
+    static const uint8_t MAX_DEPTH = 8;
+
+    uint64_t generated;
+    // Placements the move generator had to drop, any makes the count wrong.
+    uint64_t overflows;
+
+    uint64_t run(const GameCore& board, const Block::Shape* sequence, uint8_t depth);
+    static void sequence(const GameCore& board, Block::Shape* shapes, uint8_t count);
+
+  private:
+    MoveGenerator generators[MAX_DEPTH];
+
+    uint64_t count(const GameCore& board, const Block::Shape* sequence, uint8_t depth);
+};
+
+#endif
@@ -0,0 +1,30 @@
+#ifndef PLATFORM_H_
+#define PLATFORM_H_
+
+/*
+* Compile time selection of the platform policy.
+* The engine only talks to the hardware through the static members of
+* Platform, so every call resolves at compile time and can be inlined.
+*
+* A policy provides:
+*   millis(), micros()            monotonic clock
+*   profile_us()                  free running clock for measurements, real
+*                                 time even where the game clock is virtual
+*   input_init(pin, isr)          button pin with rising edge interrupt
+*   input_read(pin)               current button level, 1 while pressed
+*   wait(timeout_us)              sleep until the timeout or an interrupt
+*   signal(), wait_signal()       wake up the other core, sleep until woken
+*   core()                        number of the calling core
+*   store(data, size)             keeps a blob across power cycles
+*   load(data, size)              reads it back, false if there is none
+*   random()                      32 bit random number
+*/
+#if defined(ARDUINO)
+#include "platform_rp2040.h"
+typedef Rp2040Platform Platform;
+#else
+#include "host/platform_host.h"
+typedef HostPlatform Platform;
+#endif
+
+#endif
@@ -0,0 +1,77 @@
+#ifndef PLATFORM_RP2040_H_
+#define PLATFORM_RP2040_H_
+
+#include <Arduino.h>
+#include <EEPROM.h>
+#include <pico/platform.h>
+#include <pico/time.h>
+#include <stdint.h>
+
+
+/**
+* RP2040 platform policy on top of the Arduino core.
+*/
+class Rp2040Platform
+{
+  public:
+    static uint32_t millis() { return ::millis(); }
+    static uint32_t micros() { return ::micros(); }
+    static uint32_t profile_us() { return time_us_32(); }
+
+    static void input_init(uint8_t pin, void (*isr)())
+    {
+        pinMode(pin, INPUT_PULLDOWN);
+        attachInterrupt(pin, isr, RISING);
+    }
+
+    static uint8_t input_read(uint8_t pin) { return digitalRead(pin) == HIGH; }
+
+    static void wait(uint32_t timeout_us) { best_effort_wfe_or_timeout(make_timeout_time_us(timeout_us)); }
+    static void signal() { __sev(); }
+    static void wait_signal() { __wfe(); }
+    static uint8_t core() { return get_core_num(); }
+
+    static uint32_t random() { return rp2040.hwrand32(); }
+
+    // Blob in the last flash sector through the EEPROM emulation of the core,
+    // which keeps a RAM copy of STORAGE_SIZE bytes from the first use on.
+    static const uint16_t STORAGE_SIZE = 256;
+
+    static void store(const uint8_t* data, uint16_t size)
+    {
+        storage_begin();
+
+        for(uint16_t i = 0; i < size; i++)
+        {
+            EEPROM.write(i, data[i]);
+        }
+
+        EEPROM.commit();
+    }
+
+    static bool load(uint8_t* data, uint16_t size)
+    {
+        storage_begin();
+
+        for(uint16_t i = 0; i < size; i++)
+        {
+            data[i] = EEPROM.read(i);
+        }
+
+        return true;
+    }
+
+  private:
+    static void storage_begin()
+    {
+        static bool begun = false;
+
+        if(!begun)
+        {
+            EEPROM.begin(STORAGE_SIZE);
+            begun = true;
+        }
+    }
+};
+
+#endif
@@ -0,0 +1,226 @@
+#include "replay.h"
+#include <cstring>
+#include <stdint.h>
+
+
+static const uint8_t MAGIC[4] = {'T', 'R', 'P', 'L'};
+
+
+static void write_le(uint8_t* out, uint64_t value, uint8_t bytes)
+{
+    for(uint8_t i = 0; i < bytes; i++)
+    {
+        out[i] = value >> (8 * i);
+    }
+}
+
+
+static uint64_t read_le(const uint8_t* in, uint8_t bytes)
+{
+    uint64_t value = 0;
+
+    for(uint8_t i = 0; i < bytes; i++)
+    {
+        value |= (uint64_t)in[i] << (8 * i);
+    }
+
+    return value;
+}
+
+
+/*
+ * Magic, version, start level and seed of the game and its current state.
+ */
+uint8_t Replay::write_header(uint8_t* out, const GameCore& core)
+{
+    memcpy(out, MAGIC, sizeof(MAGIC));
+    out[4] = VERSION;
+    out[5] = core.start_level;
+    write_le(out + 6, core.seed, 4);
+    GameSnapshot::save(core, out + 10);
+    return HEADER_SIZE;
+}
+
+
+/*
+ * One frame with input as varint, 7 bits per byte and the high bit set on
+ * all but the last. A press within 7 frames of the previous one takes a byte.
+ */
+uint8_t Replay::write_event(uint8_t* out, uint32_t delta, FrameInputs inputs)
+{
+    uint64_t value = (uint64_t)delta << 4 | (inputs & 0xF);
+    uint8_t length = 0;
+
+    while(value >= 0x80)
+    {
+        out[length++] = value | 0x80;
+        value >>= 7;
+    }
+
+    out[length++] = value;
+    return length;
+}
+
+
+uint8_t Replay::write_trailer(uint8_t* out, const ReplayResult& result)
+{
+    write_le(out, result.score, 4);
+    write_le(out + 4, result.cleared_lines, 2);
+    out[6] = result.level;
+    out[7] = result.game_over;
+    write_le(out + 8, result.hash, 8);
+    return TRAILER_SIZE;
+}
+
+
+ReplayResult Replay::result(const GameCore& core)
+{
+    ReplayResult result;
+
+    result.frame = core.frame;
+    result.score = core.score;
+    result.cleared_lines = core.cleared_lines;
+    result.level = core.level;
+    result.game_over = core.game_over;
+    result.hash = core.hash();
+    return result;
+}
+
+
+/*
+ * Restores core to the recorded first state and steps it through every
+ * recorded frame. expected holds the recorded end state unless the
+ * recording has none.
+ */
+Replay::Status Replay::play(const uint8_t* data, uint32_t size, GameCore& core, ReplayResult& expected)
+{
+    if(size < HEADER_SIZE || memcmp(data, MAGIC, sizeof(MAGIC)) || data[4] != VERSION || !GameSnapshot::valid(data + 10))
+    {
+        return CORRUPT;
+    }
+
+    GameSnapshot::restore(data + 10, core);
+
+    uint32_t position = HEADER_SIZE;
+    uint32_t frame = 0;
+
+    while(position < size)
+    {
+        uint64_t value = 0;
+        uint8_t shift = 0;
+
+        do
+        {
+            // A recording may be cut anywhere, also within an event.
+            if(position == size)
+            {
+                return UNFINISHED;
+            }
+
+            if(shift > 35)
+            {
+                return CORRUPT;
+            }
+
+            value |= (uint64_t)(data[position] & 0x7F) << shift;
+            shift += 7;
+        } while(data[position++] & 0x80);
+
+        FrameInputs inputs = value & 0xF;
+        frame += value >> 4;
+
+        // Frames between events had no input.
+        while(core.frame + 1 < frame && !core.game_over)
+        {
+            core.step(0);
+        }
+
+        if(!inputs)
+        {
+            if(core.frame + 1 == frame && !core.game_over)
+            {
+                core.step(0);
+            }
+
+            if(size - position < TRAILER_SIZE)
+            {
+                return UNFINISHED;
+            }
+
+            if(size - position > TRAILER_SIZE)
+            {
+                return CORRUPT;
+            }
+
+            const uint8_t* trailer = data + position;
+
+            expected.frame = frame;
+            expected.score = read_le(trailer, 4);
+            expected.cleared_lines = read_le(trailer + 4, 2);
+            expected.level = trailer[6];
+            expected.game_over = trailer[7];
+            expected.hash = read_le(trailer + 8, 8);
+
+            ReplayResult played = result(core);
+
+            return played.frame == expected.frame && played.score == expected.score &&
+                           played.cleared_lines == expected.cleared_lines && played.level == expected.level &&
+                           played.game_over == expected.game_over && played.hash == expected.hash
+                       ? VERIFIED
+                       : MISMATCH;
+        }
+
+        core.step(inputs);
+    }
+
+    return UNFINISHED;
+}
+
+
+ReplayRecorder::ReplayRecorder() : dropped(0), last_frame(0) {}
+
+
+/*
+ * Game loop side, queues the inputs of one frame without waiting.
+ */
+void ReplayRecorder::record(uint32_t frame, FrameInputs inputs)
+{
+    if(!events.push({frame, inputs}))
+    {
+        dropped++;
+    }
+}
+
+
+/*
+ * Writer side, encodes queued events into out while they fit.
+ * Returns the number of bytes written.
+ */
+uint16_t ReplayRecorder::flush(uint8_t* out, uint16_t size)
+{
+    uint16_t length = 0;
+    const Event* event;
+
+    while(size - length >= Replay::MAX_EVENT_SIZE && (event = events.peek()))
+    {
+        length += Replay::write_event(out + length, event->frame - last_frame, event->inputs);
+        last_frame = event->frame;
+        events.release();
+    }
+
+    return length;
+}
+
+
+/*
+ * Writer side, end marker and final state once the game loop stopped and
+ * every event was flushed. out needs MAX_EVENT_SIZE + TRAILER_SIZE bytes.
+ */
+uint8_t ReplayRecorder::finish(uint8_t* out, const GameCore& core)
+{
+    ReplayResult result = Replay::result(core);
+    uint8_t length = Replay::write_event(out, result.frame - last_frame, 0);
+
+    last_frame = result.frame;
+    return length + Replay::write_trailer(out + length, result);
+}
@@ -0,0 +1,89 @@
+#ifndef REPLAY_H_
+#define REPLAY_H_
+
+#include "game_core.h"
+#include "game_snapshot.h"
+#include "spsc_ring.h"
+#include <stdint.h>
+
+
+/**
+* Final state of a game, stored at the end of a recording and compared
+* after playback.
+*/
+struct ReplayResult
+{
+    uint32_t frame;
+    uint32_t score;
+    uint16_t cleared_lines;
+    uint8_t level;
+    bool game_over;
+    uint64_t hash;
+};
+
+
+/**
+* Binary game recording, all numbers little endian.
+* Header: "TRPL", version, start level, seed (u32) and the GameSnapshot of
+* the first frame, so a recording of a resumed game starts where it did.
+* Events: one varint per frame with input, (frames since the previous event << 4) | inputs.
+* End: a varint with no inputs for the last frame, then score (u32), lines (u16),
+* level, game over and the board hash (u64). Recordings cut short have no end
+* and can be played back up to the cut.
+*/
+class Replay
+{
+  public:
+    static const uint8_t VERSION = 2;
+    static const uint8_t HEADER_SIZE = 10 + GameSnapshot::SIZE;
+    static const uint8_t MAX_EVENT_SIZE = 5;
+    static const uint8_t TRAILER_SIZE = 16;
+
+    enum Status : uint8_t
+    {
+        VERIFIED,
+        // Recording without end, played back but nothing to compare.
+        UNFINISHED,
+        MISMATCH,
+        CORRUPT
+    };
+
+    static uint8_t write_header(uint8_t* out, const GameCore& core);
+    static uint8_t write_event(uint8_t* out, uint32_t delta, FrameInputs inputs);
+    static uint8_t write_trailer(uint8_t* out, const ReplayResult& result);
+    static ReplayResult result(const GameCore& core);
+    static Status play(const uint8_t* data, uint32_t size, GameCore& core, ReplayResult& expected);
+};
+
+
+/**
+* Records the inputs of a running game.
+* The game loop only pushes frame and inputs into a ring, encoding and writing
+* happen on the consumer side, so recording never blocks a frame. Events that
+* do not fit are counted in dropped and make the recording invalid.
+*/
+class ReplayRecorder
+{
+  public:
+    struct Event
+    {
+        uint32_t frame;
+        FrameInputs inputs;
+    };
+
+    uint32_t dropped;
+
+    ReplayRecorder();
+    void record(uint32_t frame, FrameInputs inputs);
+    uint16_t flush(uint8_t* out, uint16_t size);
+    uint8_t finish(uint8_t* out, const GameCore& core);
+    // Events recorded but not flushed yet.
+    bool pending() const { return !events.empty(); }
+
+  private:
+    SpscRing<Event, 256> events;
+    // Frame of the last encoded event.
+    uint32_t last_frame;
+};
+
+#endif
@@ -0,0 +1,110 @@
+#ifndef SPSC_RING_H_
+#define SPSC_RING_H_
+
+#include <stdint.h>
+
+
+/**
+* Lock-free ring buffer for one producer and one consumer.
+* The producer only writes head and the consumer only writes tail, an acquire
+* load of the other side's index and a release store of the own one are all
+* the synchronisation needed, between the two RP2040 cores as well as between
+* host threads. SIZE has to be a power of two.
+*/
+template <typename T, uint16_t SIZE> class SpscRing
+{
+  public:
+    SpscRing() : head(0), tail(0) {}
+
+    /*
+    * Producer side, free slot to fill in place or nullptr while full.
+    */
+    T* claim()
+    {
+        uint32_t h = __atomic_load_n(&head, __ATOMIC_RELAXED);
+
+        if(h - __atomic_load_n(&tail, __ATOMIC_ACQUIRE) == SIZE)
+        {
+            return nullptr;
+        }
+
+        return &slots[h & (SIZE - 1)];
+    }
+
+    // Hands the claimed slot to the consumer.
+    void publish() { __atomic_store_n(&head, __atomic_load_n(&head, __ATOMIC_RELAXED) + 1, __ATOMIC_RELEASE); }
+
+    bool push(const T& value)
+    {
+        T* slot = claim();
+
+        if(!slot)
+        {
+            return false;
+        }
+
+        *slot = value;
+        publish();
+        return true;
+    }
+
+    /*
+    * Consumer side, oldest entry or nullptr while empty.
+    */
+    const T* peek()
+    {
+        uint32_t t = __atomic_load_n(&tail, __ATOMIC_RELAXED);
+
+        if(__atomic_load_n(&head, __ATOMIC_ACQUIRE) == t)
+        {
+            return nullptr;
+        }
+
+        return &slots[t & (SIZE - 1)];
+    }
+
+    /*
+    * Newest entry or nullptr while empty, older entries are dropped.
+    */
+    const T* newest()
+    {
+        uint32_t h = __atomic_load_n(&head, __ATOMIC_ACQUIRE);
+
+        if(h == __atomic_load_n(&tail, __ATOMIC_RELAXED))
+        {
+            return nullptr;
+        }
+
+        __atomic_store_n(&tail, h - 1, __ATOMIC_RELEASE);
+        return &slots[(h - 1) & (SIZE - 1)];
+    }
+
+    // True once the consumer released everything published, either side.
+    bool empty() const { return __atomic_load_n(&head, __ATOMIC_ACQUIRE) == __atomic_load_n(&tail, __ATOMIC_ACQUIRE); }
+
+    // Gives the entry from peek() or newest() back to the producer.
+    void release() { __atomic_store_n(&tail, __atomic_load_n(&tail, __ATOMIC_RELAXED) + 1, __ATOMIC_RELEASE); }
+
+    bool pop(T& value)
+    {
+        const T* slot = peek();
+
+        if(!slot)
+        {
+            return false;
+        }
+
+        value = *slot;
+        release();
+        return true;
+    }
+
+  private:
+    static_assert((SIZE & (SIZE - 1)) == 0, "ring size must be a power of two");
+
+    T slots[SIZE];
+    uint32_t head;
+    uint32_t tail;
+};
+
+#endif
@@ -0,0 +1,139 @@
+#include "telemetry.h"
+#include <stdint.h>
+#include <string.h>
+
+
+static const uint8_t MAGIC[4] = {'T', 'T', 'L', 'M'};
+
+const char* const Telemetry::TYPE_NAMES[TelemetryRecord::TYPE_COUNT] = {"piece_locked", "lines_cleared", "level_up",
+                                                                         "game_over", "dropped"};
+
+
+Telemetry::Telemetry() : dropped(0), reported_dropped(0) {}
+
+
+/*
+ * Game loop side, queues a record for every event of the frame core just
+ * stepped. Never waits, records that do not fit are counted in dropped.
+ */
+void Telemetry::report(const GameCore& core)
+{
+    if(core.events & GameCore::LOCKED)
+    {
+        push(core, TelemetryRecord::PIECE_LOCKED, core.lock_row);
+    }
+
+    if(core.events & GameCore::LINES_CLEARED)
+    {
+        push(core, TelemetryRecord::LINES_CLEARED, core.last_clear);
+    }
+
+    if(core.events & GameCore::LEVEL_UP)
+    {
+        push(core, TelemetryRecord::LEVEL_UP, core.level);
+    }
+
+    if(core.events & GameCore::GAME_OVER)
+    {
+        push(core, TelemetryRecord::GAME_OVER, core.level);
+    }
+}
+
+
+void Telemetry::push(const GameCore& core, TelemetryRecord::Type type, uint8_t detail)
+{
+    TelemetryRecord record = {type, detail, core.cleared_lines, core.frame, core.score};
+
+    // Only this side writes the count, so a load and a store do like SpscRing::publish().
+    if(!records.push(record))
+    {
+        __atomic_store_n(&dropped, __atomic_load_n(&dropped, __ATOMIC_RELAXED) + 1, __ATOMIC_RELEASE);
+    }
+}
+
+
+/*
+ * Writer side, moves whole records into out while they fit, a DROPPED
+ * record first if records were lost since the last call.
+ * Returns the number of bytes written.
+ */
+uint16_t Telemetry::flush(uint8_t* out, uint16_t size)
+{
+    uint16_t length = 0;
+    uint32_t lost = __atomic_load_n(&dropped, __ATOMIC_ACQUIRE) - reported_dropped;
+
+    if(lost && size >= RECORD_SIZE)
+    {
+        TelemetryRecord record = {TelemetryRecord::DROPPED, (uint8_t)lost, (uint16_t)(lost >> 8), 0, 0};
+
+        write_record(out, record);
+        reported_dropped += lost;
+        length += RECORD_SIZE;
+    }
+
+    const TelemetryRecord* record;
+
+    while(length + RECORD_SIZE <= size && (record = records.peek()))
+    {
+        write_record(out + length, *record);
+        records.release();
+        length += RECORD_SIZE;
+    }
+
+    return length;
+}
+
+
+/*
+ * Start of a stream, returns its size.
+ */
+uint8_t Telemetry::write_header(uint8_t* out)
+{
+    memcpy(out, MAGIC, sizeof(MAGIC));
+    out[4] = VERSION;
+    return HEADER_SIZE;
+}
+
+
+bool Telemetry::check_header(const uint8_t* in) { return !memcmp(in, MAGIC, sizeof(MAGIC)) && in[4] == VERSION; }
+
+
+void Telemetry::write_record(uint8_t* out, const TelemetryRecord& record)
+{
+    out[0] = record.type;
+    out[1] = record.detail;
+    out[2] = record.lines;
+    out[3] = record.lines >> 8;
+
+    for(uint8_t i = 0; i < 4; i++)
+    {
+        out[4 + i] = record.frame >> (8 * i);
+        out[8 + i] = record.score >> (8 * i);
+    }
+}
+
+
+/*
+ * Decodes one record, false for an unknown type.
+ */
+bool Telemetry::read_record(const uint8_t* in, TelemetryRecord& record)
+{
+    if(in[0] >= TelemetryRecord::TYPE_COUNT)
+    {
+        return false;
+    }
+
+    record.type = TelemetryRecord::Type(in[0]);
+    record.detail = in[1];
+    record.lines = in[2] | in[3] << 8;
+    record.frame = 0;
+    record.score = 0;
+
+    for(uint8_t i = 0; i < 4; i++)
+    {
+        record.frame |= (uint32_t)in[4 + i] << (8 * i);
+        record.score |= (uint32_t)in[8 + i] << (8 * i);
+    }
+
+    return true;
+}
@@ -0,0 +1,71 @@
+#ifndef TELEMETRY_H_
+#define TELEMETRY_H_
+
+#include "game_core.h"
+#include "spsc_ring.h"
+#include <stdint.h>
+
+
+/**
+* One game event as the host decoder sees it.
+*/
+struct TelemetryRecord
+{
+    enum Type : uint8_t
+    {
+        PIECE_LOCKED,
+        LINES_CLEARED,
+        LEVEL_UP,
+        GAME_OVER,
+        // Records lost since the previous one, count in detail and lines.
+        DROPPED,
+        TYPE_COUNT
+    };
+
+    Type type;
+    // Lock row, lines of the clear or new level, depending on the type.
+    uint8_t detail;
+    uint16_t lines;
+    uint32_t frame;
+    uint32_t score;
+};
+
+
+/**
+* Non-blocking channel of fixed size binary game events.
+* The game loop pushes records into a ring and never waits, a background
+* step flushes them in chunks of whole records. A full ring drops records,
+* the next flush reports how many as a DROPPED record.
+*
+* Stream: "TTLM", version, then 12 byte records of type, detail, lines (u16),
+* frame (u32) and score (u32), little endian.
+*/
+class Telemetry
+{
+  public:
+    static const uint8_t VERSION = 1;
+    static const uint8_t HEADER_SIZE = 5;
+    static const uint8_t RECORD_SIZE = 12;
+    static const char* const TYPE_NAMES[TelemetryRecord::TYPE_COUNT];
+
+    // Records that did not fit, written by report() and read by flush().
+    uint32_t dropped;
+
+    Telemetry();
+    void report(const GameCore& core);
+    uint16_t flush(uint8_t* out, uint16_t size);
+
+    static uint8_t write_header(uint8_t* out);
+    static bool check_header(const uint8_t* in);
+    static void write_record(uint8_t* out, const TelemetryRecord& record);
+    static bool read_record(const uint8_t* in, TelemetryRecord& record);
+
+  private:
+    SpscRing<TelemetryRecord, 64> records;
+    // Drops already reported by flush().
+    uint32_t reported_dropped;
+
+    void push(const GameCore& core, TelemetryRecord::Type type, uint8_t detail);
+};
+
+#endif
@@ -1,55 +1,52 @@
-#include "TFT_eSPI.h"
 #include "tetris.h"
-#include <Arduino.h>
-#include <algorithm>
-#include <cstring>
-#include <math.h>
-#include <sys/_stdint.h>
+#include <stdint.h>
+#include <string.h>
 
 
-uint32_t Tetris::debounce;
-bool Tetris::move_left_flag;
-bool Tetris::move_right_flag;
-bool Tetris::rotate_left_flag;
-bool Tetris::rotate_right_flag;
-
-const float Tetris::SPEED_TABLE[12] = {48.0, 43.0, 38.0, 33.0, 28.0, 18.0, 13.0, 8.0,  6.0,  5.0, 5.0, 5.0};
+InputQueue Tetris::input_queue;
 
 
 Tetris::Tetris()
 {
-    pinMode(PIN_MOVE_LEFT, INPUT_PULLDOWN);
-    pinMode(PIN_MOVE_RIGHT, INPUT_PULLDOWN);
-    pinMode(PIN_ROTATE_LEFT, INPUT_PULLDOWN);
-    pinMode(PIN_ROTATE_RIGHT, INPUT_PULLDOWN);
-
-    score = 0;
-    level = 6;
-    game_over = false;
-    cleared_lines = 0;
+    // New game with the first block.
+    core.reset(Platform::random(), START_LEVEL);
+    shown_score = core.score;
+    shown_level = core.level;
 
-    // Movement delay of blocks depends on level.
-    move_delay = (uint16_t)(SPEED_TABLE[level] / 60.0 * 1000.0);
+    // Initial screen, later frames only flush what changed.
+    display.fill(BACKGROUND);
+    draw_playfield();
+    draw_score();
+    draw_level();
+    display.flush();
 
-    // Init field.
-    for(uint8_t x = 0; x < SQUARES_PER_ROW; x++)
+    for(uint8_t y = 0; y < SQUARES_PER_COLUMN; y++)
     {
-        for(uint8_t y = 0; y < SQUARES_PER_COLUMN; y++)
+        for(uint8_t x = 0; x < SQUARES_PER_ROW; x++)
         {
-            field_squares[x][y].init(x, y, TFT_BLACK, false);
+            shown_colors[y][x] = BACKGROUND;
         }
     }
 
-    // Initial screen.
-    display.fill(BACKGROUND);
-    draw_playfield();
     init_button_isr();
 
-    // Create first block.
-    block.init();
-
-    // Enter main thread.
-    run();
+    start_time = Platform::millis();
+    frames_done = 0;
+    autoplayer = nullptr;
+    recorder = nullptr;
+    telemetry = nullptr;
+    pipelined = false;
+    snapshot_pending = true;
+    game_stored = false;
+    store_pending = false;
+    idle_us = 0;
+    wakeups = 0;
+    last_held = 0;
+    paused = false;
+    chord_held = false;
+    chord_used = false;
+    chord_start = 0;
+    pause_time = 0;
 }
 
 
@@ -58,658 +55,610 @@ Tetris::Tetris()
  */
 void Tetris::init_button_isr()
 {
-    attachInterrupt(PIN_MOVE_LEFT, Tetris::move_left, RISING);
-    attachInterrupt(PIN_MOVE_RIGHT, Tetris::move_right, RISING);
-    attachInterrupt(PIN_ROTATE_LEFT, Tetris::rotate_left, RISING);
-    attachInterrupt(PIN_ROTATE_RIGHT, Tetris::rotate_right, RISING);
+    Platform::input_init(PIN_MOVE_LEFT, Tetris::move_left);
+    Platform::input_init(PIN_MOVE_RIGHT, Tetris::move_right);
+    Platform::input_init(PIN_ROTATE_LEFT, Tetris::rotate_left);
+    Platform::input_init(PIN_ROTATE_RIGHT, Tetris::rotate_right);
 }
 
 
 /*
- * Clear button flags.
+ * Button presses of a frame that is due, those that came after its start
+ * time belong to a later frame.
  */
-void Tetris::clear_flags()
+FrameInputs Tetris::take_inputs(uint32_t frame)
 {
-    move_left_flag = false;
-    move_right_flag = false;
-    rotate_left_flag = false;
-    rotate_right_flag = false;
-}
+    uint32_t late_ms = Platform::millis() - frame_time(frame);
 
-/*
- * Move block to the left.
- */
-void Tetris::move_left()
-{
-    if(millis() - debounce > DEBOUNCE_DELAY)
-    {
-        move_left_flag = true;
-        debounce = millis();
-    }
+    return input_queue.drain(Platform::micros(), late_ms * 1000);
 }
 
 
 /*
- * Move block to the right.
+ * Time on the millis clock when a frame is due.
  */
-void Tetris::move_right()
+uint32_t Tetris::frame_time(uint32_t frame)
 {
-    if(millis() - debounce > DEBOUNCE_DELAY)
-    {
-        move_right_flag = true;
-        debounce = millis();
-    }
+    return start_time + (uint32_t)(((uint64_t)frame * 1000 + GameCore::FRAME_RATE - 1) / GameCore::FRAME_RATE);
 }
 
+
 /*
- * Block rotation to the left.
+ * Bitmask of the buttons that are down, in the order of GameCore::Input.
  */
-void Tetris::rotate_left()
+uint8_t Tetris::held_buttons()
 {
-    if(millis() - debounce > DEBOUNCE_DELAY)
-    {
-        rotate_left_flag = true;
-        debounce = millis();
-    }
+    return Platform::input_read(PIN_MOVE_LEFT) | Platform::input_read(PIN_MOVE_RIGHT) << 1 |
+           Platform::input_read(PIN_ROTATE_LEFT) << 2 | Platform::input_read(PIN_ROTATE_RIGHT) << 3;
 }
 
+
+// Button ISRs, the button index is the bit of its GameCore::Input.
+void Tetris::move_left() { input_queue.edge(0, Platform::micros()); }
+void Tetris::move_right() { input_queue.edge(1, Platform::micros()); }
+void Tetris::rotate_left() { input_queue.edge(2, Platform::micros()); }
+void Tetris::rotate_right() { input_queue.edge(3, Platform::micros()); }
+
+
 /*
- * Block rotation to the right.
+ * Tetris thread.
  */
-void Tetris::rotate_right()
+void Tetris::run()
 {
-    if(millis() - debounce > DEBOUNCE_DELAY)
+    while(true)
     {
-        rotate_right_flag = true;
-        debounce = millis();
+        tick();
+        sleep();
     }
 }
 
 
 /*
- * Tetris thread.
+ * Time on the millis clock when tick() has work again.
+ * Without input, auto shift, bot or pending snapshot that is the frame where
+ * gravity moves the block, a finished game has no deadline at all. The frame
+ * clock stands still while paused, then only presses to drop and a held
+ * pause chord have one.
  */
-void Tetris::run()
+uint32_t Tetris::next_deadline()
 {
-    uint32_t timestamp = 0;
-    uint32_t timestamp_draw = 0;
+    uint8_t held = held_buttons();
+    uint32_t now = Platform::millis();
+    uint32_t deadline;
 
-    while(true)
+    if(paused)
     {
-        if(game_over)
-        {
-            fill_playfield();
-            refresh_screen();
-            continue;
-        }
-
-        if(move_left_flag)
-        {
-            move_block_left();
-            refresh_screen();
-            clear_flags();
-            continue;
-        }
-
-        if(move_right_flag)
-        {
-            move_block_right();
-            refresh_screen();
-            clear_flags();
-            continue;
-        }
-
-        if(rotate_left_flag)
-        {
-            rotate_block(Block::LEFT);
-            refresh_screen();
-            clear_flags();
-            continue;
-        }
-
-        if(rotate_right_flag)
-        {
-            rotate_block(Block::RIGHT);
-            refresh_screen();
-            clear_flags();
-            continue;
-        }
+        deadline = now + (snapshot_pending || input_queue.pending() ? FRAME_MS : MAX_SLEEP_MS);
+    }
+    else
+    {
+        bool every_frame = snapshot_pending || autoplayer || input_queue.pending() || (held & AutoRepeat::REPEATING);
 
-        // Block movement.
-        if(millis() - timestamp > move_delay)
+        if(core.game_over && !every_frame)
         {
-            move_block_downwards();
-            timestamp = millis();
+            deadline = now + MAX_SLEEP_MS;
         }
-
-        // Drawing of screen.
-        if(millis() - timestamp_draw > 1000 / FPS)
+        else
         {
-            refresh_screen();
-            timestamp_draw = millis();
+            deadline = frame_time(frames_done + (every_frame ? 1 : core.frames_until_gravity()));
         }
     }
-}
 
-
-/*
- * Finish block after it reached ground.
- */
-void Tetris::finish_block()
-{
-    for(uint8_t i = 0; i < block.SQUARE_NUMBER; i++)
+    // The tick after the hold time toggles the pause.
+    if(chord_held && !chord_used && !core.game_over && (int32_t)(chord_start + PAUSE_HOLD_MS - deadline) < 0)
     {
-        uint8_t x = block.squares[i].x + block.center.x;
-        uint8_t y = block.squares[i].y + block.center.y;
-
-        field_squares[x][y].filled = true;
-        field_squares[x][y].color = block.color;
+        deadline = chord_start + PAUSE_HOLD_MS;
     }
 
-    clear_full_lines();
-    block.init();
+    return deadline;
 }
 
 
 /*
- * Moves active tetris block to the left.
+ * Waits for the next deadline, a button interrupt ends the wait early.
  */
-void Tetris::move_block_left()
+void Tetris::sleep()
 {
-    Block dummy_block(block);
-    dummy_block.move_left();
+    int32_t wait_ms = next_deadline() - Platform::millis();
 
-    if(intersect_borders(dummy_block) || intersection(dummy_block))
+    if(wait_ms <= 0)
     {
         return;
     }
 
-    block.move_left();
+    if(wait_ms > MAX_SLEEP_MS)
+    {
+        wait_ms = MAX_SLEEP_MS;
+    }
+
+    uint32_t before = Platform::micros();
+    Platform::wait(wait_ms * 1000);
+    idle_us += Platform::micros() - before;
+    wakeups++;
 }
 
 
 /*
- * Moves active tetris block to the right.
+ * One pass of the logic loop.
+ * Steps the core once for every frame period that elapsed and publishes the
+ * result once, every frame takes its share of queued presses and auto shifts.
  */
-void Tetris::move_block_right()
+void Tetris::tick()
 {
-    Block b(block);
-    b.move_right();
+    TRACE_ARM();
+    TRACE_SPAN(TICK);
+
+    uint32_t tick_start = Platform::profile_us();
+    uint8_t held = held_buttons();
+
+    uint32_t due = (uint64_t)(Platform::millis() - start_time) * GameCore::FRAME_RATE / 1000;
 
-    if(intersect_borders(b) || intersection(b))
+    if(update_pause(held))
     {
-        return;
+        // No frames are due while paused, presses are dropped rather than applied on continuing.
+        due = frames_done;
+
+        while(input_queue.pending())
+        {
+            input_queue.drain(Platform::micros(), 0);
+        }
     }
 
-    block.move_right();
-}
+    if(due != frames_done)
+    {
+        // A newly held button counts from the frame that takes its press.
+        uint8_t counted = last_held;
 
+        while(frames_done != due)
+        {
+            FrameInputs inputs = take_inputs(frames_done + 1);
 
-/*
- * Moves active tetris block downwards.
- */
-void Tetris::move_block_downwards()
-{
-    if(block_finished())
-    {
-        finish_block();
-        return;
-    }
+            // Held together the rotate buttons are the pause chord, not moves.
+            if((held & PAUSE_CHORD) == PAUSE_CHORD)
+            {
+                inputs &= ~PAUSE_CHORD;
+            }
 
-    block.move_down();
-}
+            if(inputs)
+            {
+                InputStamp stamp = {input_queue.drained_time, core.frame + 1};
 
+                if(!unshown_inputs.push(stamp))
+                {
+                    stats.untracked_inputs++;
+                }
+            }
 
-/*
- * Rotates block.
- */
-void Tetris::rotate_block(Block::Direction d)
-{
-    Block b(block);
-    b.rotate(d);
+            counted |= inputs;
+            inputs |= auto_repeat.update(held & counted);
 
-    if(intersect_borders(b) || intersection(b))
-    {
-        return;
-    }
+            if(autoplayer)
+            {
+                // The search steps copies of the core, only the game itself is traced.
+                TRACE_PAUSE();
+                inputs |= autoplayer->inputs(core);
+            }
 
-    block.rotate(d);
-}
+            if(recorder && inputs && !core.game_over)
+            {
+                recorder->record(core.frame + 1, inputs);
+            }
 
+            uint8_t events = core.step(inputs);
 
-void Tetris::update_score(uint8_t full_lines)
-{
-    switch(full_lines)
-    {
-        case 1:
-            score += ONE_LINE_POINTS * (level + 1);
-            break;
+            if(events && telemetry)
+            {
+                telemetry->report(core);
+            }
 
-        case 2:
-            score += TWO_LINES_POINTS * (level + 1);
-            break;
+            // A finished game replaces a stored one, it is not resumed.
+            if((events & GameCore::GAME_OVER) && game_stored)
+            {
+                store_pending = true;
+            }
 
-        case 3:
-            score += THREE_LINES_POINTS * (level + 1);
-            break;
+            frames_done++;
+        }
 
-        case 4:
-            score += FOUR_LINES_POINTS * (level + 1);
-            break;
+        snapshot_pending = true;
     }
 
-    cleared_lines += full_lines;
+    // Sampled on every wake up, so a release between frames is not missed.
+    last_held = held;
 
-    if(cleared_lines >= (level + 1) * 10)
+    // A full ring means the renderer is behind, the next tick publishes the newer state.
+    if(snapshot_pending)
     {
-        level++;
-        move_delay = (uint16_t)(SPEED_TABLE[level] / 60.0 * 1000.0);
+        snapshot_pending = !publish();
+    }
+
+    uint32_t logic_us = Platform::profile_us() - tick_start;
+    stats.logic.add(logic_us);
+    stats.late_ticks += logic_us > FrameStats::FRAME_US;
+
+    if(!pipelined)
+    {
+        render();
+    }
+
+    // Erasing flash takes milliseconds, so it waits until the frame is out.
+    if(store_pending)
+    {
+        store_pending = false;
+        save();
     }
 }
 
 
 /*
- * Clears lines filled by user.
+ * Toggles the pause once the pause chord was held for PAUSE_HOLD_MS, a
+ * pause saves the game. Returns true while paused.
  */
-void Tetris::clear_full_lines()
+bool Tetris::update_pause(uint8_t held)
 {
-    bool full = true;
-    uint8_t full_lines = 0;
+    uint32_t now = Platform::millis();
 
-    for(uint8_t i = SQUARES_PER_COLUMN - 1; i > 0; i--)
+    if((held & PAUSE_CHORD) != PAUSE_CHORD)
     {
-        full = true;
+        chord_held = false;
+        return paused;
+    }
 
-        for(uint8_t j = 0; j < SQUARES_PER_ROW; j++)
-        {
-            if(!field_squares[j][i].filled)
-            {
-                full = false;
-                break;
-            }
-        }
+    if(!chord_held)
+    {
+        chord_held = true;
+        chord_used = false;
+        chord_start = now;
+    }
 
-        if(full)
-        {
-            full_lines++;
-        }
-        else if(full_lines)
-        {
-            for(uint8_t k = 0; k < full_lines; k++)
-            {
-                shift_field_down(i + k + 1);
-                clear_line(k + 1);
-            }
+    if(!chord_used && now - chord_start >= PAUSE_HOLD_MS && !core.game_over)
+    {
+        chord_used = true;
+        pause(!paused);
 
-            update_score(full_lines);
-            full_lines = 0;
+        if(paused)
+        {
+            save();
         }
     }
+
+    return paused;
 }
 
+
 /*
- * Shifts part of field down.
+ * Stops or continues the frame clock, the paused time is left out of it.
  */
-void Tetris::shift_field_down(uint8_t index)
+void Tetris::pause(bool on)
 {
-    for(uint8_t i = index; i > 0; i--)
+    if(on == paused)
     {
-        shift_line_down(i);
+        return;
     }
-}
 
-
-/*
- * Shifts down line.
- */
-void Tetris::shift_line_down(uint8_t index)
-{
-    for(uint8_t i = 0; i < SQUARES_PER_ROW; i++)
+    if(on)
     {
-        field_squares[i][index].init(i, index, field_squares[i][index - 1].color, field_squares[i][index - 1].filled);
+        pause_time = Platform::millis();
     }
+    else
+    {
+        start_time += Platform::millis() - pause_time;
+    }
+
+    paused = on;
 }
 
 
 /*
- * Clears line.
+ * Keeps the game state in the platform storage, flash on the device.
  */
-void Tetris::clear_line(uint8_t index)
+void Tetris::save()
 {
-    for(uint8_t i = 0; i < SQUARES_PER_ROW; i++)
-    {
-        field_squares[i][index].init(i, index, TFT_BLACK, false);
-    }
+    uint8_t blob[GameSnapshot::SIZE];
+
+    GameSnapshot::save(core, blob);
+    Platform::store(blob, sizeof(blob));
+    game_stored = !core.game_over;
 }
 
 
 /*
- * Checks if the active block has reached any ground and is finished.
+ * Continues a saved game that is not over, false if there is none.
+ * Nothing is replayed, the core is restored and the next frame draws it.
  */
-bool Tetris::block_finished()
+bool Tetris::resume()
 {
-    Block b(block);
-    b.move_down();
+    uint8_t blob[GameSnapshot::SIZE];
 
-    for(uint8_t i = 0; i < block.SQUARE_NUMBER; i++)
+    if(!Platform::load(blob, sizeof(blob)) || !GameSnapshot::valid(blob))
     {
-        if((block.center.y + block.squares[i].y == SQUARES_PER_COLUMN - 1) || intersection(b))
-        {
-            Serial.println(block.center.y + block.squares[i].y);
+        return false;
+    }
 
+    GameCore saved;
+    GameSnapshot::restore(blob, saved);
 
-            if(block.center.y == 0)
-            {
-                game_over = true;
-            }
-
-            return true;
-        }
+    if(saved.game_over)
+    {
+        return false;
     }
 
-    return false;
+    core = saved;
+    game_stored = true;
+    last_held = 0;
+    snapshot_pending = true;
+    return true;
 }
 
+
 /*
- * Checks if the current clock intersects with any field border.
+ * Hands the current state to the render side, false while the ring is full.
  */
-bool Tetris::intersect_borders(Block b)
+bool Tetris::publish()
 {
-    for(uint8_t i = 0; i < block.SQUARE_NUMBER; i++)
-    {
-        uint8_t x = b.squares[i].x + b.center.x;
-        uint8_t y = b.squares[i].y + b.center.y;
+    FrameSnapshot* frame = frames.claim();
 
-        if(x >= SQUARES_PER_ROW || y >= SQUARES_PER_COLUMN)
-        {
-            return true;
-        }
+    if(!frame)
+    {
+        return false;
     }
 
-    return false;
+    snapshot(*frame);
+    frames.publish();
+    Platform::signal();
+    return true;
 }
 
 
 /*
- * Checks if the current clock intersects any other block on the field.
+ * One pass of the render loop, draws the newest published frame and skips
+ * older ones. Returns false if nothing was published since the last call.
  */
-bool Tetris::intersection(Block b)
+bool Tetris::render()
 {
-    for(uint8_t i = 0; i < block.SQUARE_NUMBER; i++)
+    TRACE_ARM();
+    const FrameSnapshot* frame = frames.newest();
+
+    if(!frame)
     {
-        uint8_t x = b.squares[i].x + b.center.x;
-        uint8_t y = b.squares[i].y + b.center.y;
+        return false;
+    }
 
+    uint32_t start = Platform::profile_us();
+    uint32_t shown = frame->frame;
 
-        if(field_squares[x][y].filled)
-        {
-            return true;
-        }
-    }
+    refresh_screen(*frame);
 
-    return false;
-}
+    uint32_t render_us = Platform::profile_us() - start;
+    stats.render.add(render_us);
+    stats.missed_frames += render_us > FrameStats::FRAME_US;
 
+    // Presses up to the drawn frame are on the panel now.
+    uint32_t now = Platform::micros();
+    const InputStamp* stamp;
 
-/**
- * Fills the whole playfield with blocks.
- */
-void Tetris::fill_playfield()
-{
-    for(uint8_t x = 0; x < SQUARES_PER_ROW; x++)
+    while((stamp = unshown_inputs.peek()) && (int32_t)(stamp->frame - shown) <= 0)
     {
-        for(uint8_t y = 0; y < SQUARES_PER_COLUMN; y++)
-        {
-            field_squares[x][y].init(x, y, TFT_SKYBLUE, true);
-        }
+        stats.latency.add(now - stamp->time);
+        unshown_inputs.release();
     }
+
+    // Released last, an empty ring tells the logic side the frame is on the panel.
+    frames.release();
+    return true;
 }
 
+
 /*
- * Refresh the screen with current data.
+ * Copies what the renderer needs out of the core.
  */
-void Tetris::refresh_screen()
+void Tetris::snapshot(FrameSnapshot& frame)
 {
-    display.fill(BACKGROUND);
-    draw_blocks();
-    draw_playfield();
-    display.flush();
+    compose_frame(frame.squares);
+    frame.score = core.score;
+    frame.level = core.level;
+    frame.frame = core.frame;
 }
 
 
 /*
- * Draws the tetris field.
+ * Refresh the screen with current data.
+ * Only squares and numbers that changed since the last call are drawn,
+ * each damaged row and text region is flushed as its own window.
  */
-void Tetris::draw_playfield()
+void Tetris::refresh_screen(const FrameSnapshot& frame)
 {
-    display.vline(X_LEFT, 0, SQUARES_PER_COLUMN * SQUARE_WIDTH, TFT_WHITE);
-    display.vline(X_LEFT + 1, 0, SQUARES_PER_COLUMN * SQUARE_WIDTH, TFT_WHITE);
-    display.vline(X_RIGHT, 0, SQUARES_PER_COLUMN * SQUARE_WIDTH, TFT_WHITE);
-    display.vline(X_RIGHT - 1, 0, SQUARES_PER_COLUMN * SQUARE_WIDTH, TFT_WHITE);
-    display.line(X_RIGHT, 160 - 3, X_LEFT, 160 - 3, TFT_WHITE);
-    display.line(X_RIGHT, 160 - 2, X_LEFT, 160 - 2, TFT_WHITE);
+    TRACE_SPAN(REFRESH_SCREEN);
 
-    // Draw score and level.
-    display.number(score, 121, 0, TFT_WHITE);
-    display.number(level, 20, 0, TFT_GREENYELLOW);
-}
+    int8_t first[SQUARES_PER_COLUMN];
+    int8_t last[SQUARES_PER_COLUMN];
 
+    draw_blocks(frame.squares, first, last);
 
-/*
- * Draws all blocks existing in the field.
- */
-void Tetris::draw_blocks()
-{
-    for(uint8_t x = 0; x < SQUARES_PER_ROW; x++)
+    bool score_damaged = frame.score != shown_score;
+    bool level_damaged = frame.level != shown_level;
+
+    // Redrawn squares below the numbers erase their glyphs.
+    for(uint8_t y = 0; y * SQUARE_WIDTH + 1 < TEXT_HEIGHT; y++)
     {
-        for(uint8_t y = 0; y < SQUARES_PER_COLUMN; y++)
+        if(first[y] < 0)
         {
-            if(field_squares[x][y].filled)
-            {
-                draw_square(field_squares[x][y]);
-            }
+            continue;
         }
-    }
-
-    draw_current_block();
-}
 
+        score_damaged |= last[y] * SQUARE_WIDTH + 2 + X_LEFT + 10 > SCORE_X;
+        level_damaged |= first[y] * SQUARE_WIDTH + 2 + X_LEFT <= LEVEL_RIGHT;
+    }
 
-/*
- * Draws a tetris block.
- */
-void Tetris::draw_current_block()
-{
-    Block b(block);
+    shown_score = frame.score;
+    shown_level = frame.level;
 
-    for(uint8_t i = 0; i < block.SQUARE_NUMBER; i++)
+    if(score_damaged)
     {
-        b.squares[i].x = b.center.x + b.squares[i].x;
-        b.squares[i].y = b.center.y + b.squares[i].y;
-        draw_square(b.squares[i]);
+        draw_text_region(SCORE_X, SCORE_RIGHT, frame.squares);
     }
-}
-
-
-/*
- * Draws one square of a tetris block.
- */
-void Tetris::draw_square(Square f)
-{
-    uint16_t x_pixel = f.x * SQUARE_WIDTH + 2 + X_LEFT;
-    uint16_t y_pixel = f.y * SQUARE_WIDTH + 1;
 
-    display.filled_rectangle(x_pixel, y_pixel, 10, 10, f.color);
-}
+    if(level_damaged)
+    {
+        draw_text_region(LEVEL_X, LEVEL_RIGHT, frame.squares);
+    }
 
+    uint32_t flush_start = Platform::profile_us();
 
-Block::Block() {}
+    for(uint8_t y = 0; y < SQUARES_PER_COLUMN; y++)
+    {
+        if(first[y] < 0)
+        {
+            continue;
+        }
 
+        uint8_t x_pixel = first[y] * SQUARE_WIDTH + 2 + X_LEFT;
+        uint8_t width = (last[y] - first[y]) * SQUARE_WIDTH + 10;
 
-Block::Block(const Block& b)
-{
-    color = b.color;
-    center.x = b.center.x;
-    center.y = b.center.y;
-    shape = b.shape;
+        display.flush(x_pixel, y * SQUARE_WIDTH + 1, width, 10);
+    }
 
+    if(score_damaged)
+    {
+        display.flush(SCORE_X, 0, SCORE_RIGHT - SCORE_X + 1, TEXT_HEIGHT);
+    }
 
-    for(uint8_t i = 0; i < b.SQUARE_NUMBER; i++)
+    if(level_damaged)
     {
-        squares[i].x = b.squares[i].x;
-        squares[i].y = b.squares[i].y;
-        squares[i].color = b.squares[i].color;
+        display.flush(LEVEL_X, 0, LEVEL_RIGHT - LEVEL_X + 1, TEXT_HEIGHT);
     }
+
+    stats.flush.add(Platform::profile_us() - flush_start);
 }
 
+
 /*
- * Creates a new block per random selection.
+ * Square colors of the next frame, field squares plus the active block.
  */
-void Block::init()
+void Tetris::compose_frame(uint16_t frame[SQUARES_PER_COLUMN][SQUARES_PER_ROW])
 {
-    center.x = 4;
-    center.y = 0;
-
-    shape = Shape(rp2040.hwrand32() % 7);
-
-    switch(shape)
-    {
-        case I:
-            set_coords(-2, 1, 0);
-            set_coords(-1, 1, 1);
-            set_coords(0, 1, 2);
-            set_coords(1, 1, 3);
-            break;
-
-        case J:
-            set_coords(-1, 1, 0);
-            set_coords(-1, 0, 1);
-            set_coords(0, 0, 2);
-            set_coords(1, 0, 3);
-            break;
-
-        case S:
-            set_coords(1, 1, 0);
-            set_coords(0, 1, 1);
-            set_coords(0, 0, 2);
-            set_coords(-1, 0, 3);
-            break;
-
-        case Z:
-            set_coords(-1, 1, 0);
-            set_coords(0, 1, 1);
-            set_coords(0, 0, 2);
-            set_coords(1, 0, 3);
-            break;
-
-        case O:
-            set_coords(-1, 0, 0);
-            set_coords(0, 0, 1);
-            set_coords(-1, -1, 2);
-            set_coords(0, -1, 3);
-            break;
-
-        case L:
-            set_coords(-1, 0, 0);
-            set_coords(0, 0, 1);
-            set_coords(1, 0, 2);
-            set_coords(1, 1, 3);
-            break;
-
-        case T:
-            set_coords(-1, 0, 0);
-            set_coords(0, 0, 1);
-            set_coords(0, 1, 2);
-            set_coords(1, 0, 3);
-            break;
-    }
-
-    color = get_color();
-    squares[0].color = color;
-    squares[1].color = color;
-    squares[2].color = color;
-    squares[3].color = color;
+    for(uint8_t y = 0; y < SQUARES_PER_COLUMN; y++)
+    {
+        uint16_t row = core.field_rows[y];
+
+        for(uint8_t x = 0; x < SQUARES_PER_ROW; x++, row >>= 1)
+        {
+            frame[y][x] = (row & 1) ? core.field_colors[y][x] : BACKGROUND;
+        }
+    }
+
+    for(uint8_t i = 0; i < core.block.SQUARE_NUMBER; i++)
+    {
+        uint8_t x = core.block.center.x + core.block.squares[i].x;
+        uint8_t y = core.block.center.y + core.block.squares[i].y;
+
+        if(x < SQUARES_PER_ROW && y < SQUARES_PER_COLUMN)
+        {
+            frame[y][x] = core.block.color;
+        }
+    }
 }
 
 
 /*
- * Get block color.
+ * Draws the tetris field border.
  */
-uint32_t Block::get_color()
+void Tetris::draw_playfield()
 {
-    switch(shape)
-    {
-        case L:
-            return TFT_RED;
-        case J:
-            return TFT_BLUE;
-        case S:
-            return TFT_GREEN;
-        case Z:
-            return TFT_YELLOW;
-        case O:
-            return TFT_CYAN;
-        case I:
-            return TFT_ORANGE;
-        case T:
-            return TFT_PURPLE;
-    }
-
-    return TFT_RED;
+    display.vline(X_LEFT, 0, SQUARES_PER_COLUMN * SQUARE_WIDTH, TFT_WHITE);
+    display.vline(X_LEFT + 1, 0, SQUARES_PER_COLUMN * SQUARE_WIDTH, TFT_WHITE);
+    display.vline(X_RIGHT, 0, SQUARES_PER_COLUMN * SQUARE_WIDTH, TFT_WHITE);
+    display.vline(X_RIGHT - 1, 0, SQUARES_PER_COLUMN * SQUARE_WIDTH, TFT_WHITE);
+    display.line(X_RIGHT, 160 - 3, X_LEFT, 160 - 3, TFT_WHITE);
+    display.line(X_RIGHT, 160 - 2, X_LEFT, 160 - 2, TFT_WHITE);
 }
 
 
+void Tetris::draw_score() { display.number(shown_score, SCORE_RIGHT, 0, TFT_WHITE); }
+void Tetris::draw_level() { display.number(shown_level, LEVEL_RIGHT, 0, TFT_GREENYELLOW); }
+
+
 /*
- * Set block coordinates.
+ * Draws all squares that differ from the last flush.
+ * Returns the first and last changed column per row, -1 for untouched rows.
  */
-void Block::set_coords(int8_t x, int8_t y, uint8_t index)
+void Tetris::draw_blocks(const uint16_t frame[SQUARES_PER_COLUMN][SQUARES_PER_ROW], int8_t first[], int8_t last[])
 {
-    if(index >= SQUARE_NUMBER)
+    for(uint8_t y = 0; y < SQUARES_PER_COLUMN; y++)
     {
-        return;
-    }
+        first[y] = -1;
+        last[y] = -1;
+
+        for(uint8_t x = 0; x < SQUARES_PER_ROW; x++)
+        {
+            if(frame[y][x] == shown_colors[y][x])
+            {
+                continue;
+            }
+
+            if(first[y] < 0)
+            {
+                first[y] = x;
+            }
+
+            last[y] = x;
+        }
+
+        if(first[y] == 0 && last[y] == SQUARES_PER_ROW - 1)
+        {
+            // Cleared and shifted rows change end to end, drawn as one run of tiles.
+            display.tile_row(2 + X_LEFT, y * SQUARE_WIDTH + 1, frame[y], SQUARES_PER_ROW, SQUARE_WIDTH, BACKGROUND);
+            memcpy(shown_colors[y], frame[y], sizeof(shown_colors[y]));
+            continue;
+        }
 
-    squares[index].x = x;
-    squares[index].y = y;
+        for(int8_t x = first[y]; x >= 0 && x <= last[y]; x++)
+        {
+            if(frame[y][x] != shown_colors[y][x])
+            {
+                draw_square(x, y, frame[y][x]);
+                shown_colors[y][x] = frame[y][x];
+            }
+        }
+    }
 }
 
 
 /*
- * 90° block rotation.
+ * Redraws a number region from scratch: background, squares below, border and text.
  */
-void Block::rotate(Direction d)
+void Tetris::draw_text_region(uint8_t x, uint8_t right, const uint16_t frame[SQUARES_PER_COLUMN][SQUARES_PER_ROW])
 {
-    if(shape == O)
-    {
-        return;
-    }
-    else if(shape == I)
-    {
-    }
+    display.filled_rectangle(x, 0, right - x + 1, TEXT_HEIGHT, BACKGROUND);
 
-    // Simplified rotation matrix for left or right.
-    int8_t factor = (d == RIGHT) ? 1 : -1;
-
-    for(uint8_t i = 0; i < SQUARE_NUMBER; i++)
+    for(uint8_t row = 0; row * SQUARE_WIDTH + 1 < TEXT_HEIGHT; row++)
     {
-        int8_t x_temp = squares[i].x;
-        squares[i].x = squares[i].y * factor * (-1);
-        squares[i].y = x_temp * factor;
+        for(uint8_t column = 0; column < SQUARES_PER_ROW; column++)
+        {
+            uint16_t x_pixel = column * SQUARE_WIDTH + 2 + X_LEFT;
+
+            if(x_pixel + 10 > x && x_pixel <= right)
+            {
+                draw_square(column, row, frame[row][column]);
+            }
+        }
     }
-}
 
-void Block::move_left() { center.x++; }
-void Block::move_right() { center.x--; }
-void Block::move_down() { center.y++; }
+    draw_playfield();
+    draw_score();
+    draw_level();
+}
 
 
 /*
- * Set square values.
+ * Draws one square of a tetris block from the tile atlas, empty squares flat.
  */
-void Square::init(int8_t x, int8_t y, uint32_t color, bool filled)
+void Tetris::draw_square(uint8_t x, uint8_t y, uint16_t color)
 {
-    this->x = x;
-    this->y = y;
-    this->color = color;
-    this->filled = filled;
+    uint16_t x_pixel = x * SQUARE_WIDTH + 2 + X_LEFT;
+    uint16_t y_pixel = y * SQUARE_WIDTH + 1;
+
+    display.tile(x_pixel, y_pixel, color, color != BACKGROUND);
 }
+
+
@@ -1,69 +1,50 @@
 #ifndef TETRIS_H_
 #define TETRIS_H_
 
+#include "bot.h"
 #include "display.h"
-#include <TFT_eSPI.h>
-#include <sys/_stdint.h>
+#include "frame_stats.h"
+#include "game_core.h"
+#include "game_snapshot.h"
+#include "input_queue.h"
+#include "platform.h"
+#include "replay.h"
+#include "spsc_ring.h"
+#include "telemetry.h"
+#include "trace.h"
+#include <stdint.h>
 
 
 /**
-* Tetris square part of block.
+* Immutable state of one frame as the renderer sees it, field squares with
+* the active block already drawn in.
 */
-class Square
+struct FrameSnapshot
 {
-  public:
-    int8_t x;
-    int8_t y;
-    uint32_t color;
-    bool filled;
-
-    void init(int8_t x, int8_t y, uint32_t color, bool filled);
+    uint16_t squares[GameCore::SQUARES_PER_COLUMN][GameCore::SQUARES_PER_ROW];
+    uint32_t score;
+    uint8_t level;
+    // Game frame the snapshot was taken after.
+    uint32_t frame;
 };
 
+
 /**
-* Tetris block.
+* Button press on its way to the screen, the interrupt time and the game
+* frame that applied it.
 */
-class Block
+struct InputStamp
 {
-  public:
-    static const uint8_t SQUARE_NUMBER = 4;
-
-    enum Shape
-    {
-        L,
-        J,
-        S,
-        Z,
-        O,
-        I,
-        T
-    };
-
-    enum Direction
-    {
-        LEFT,
-        RIGHT
-    };
-
-
-    Shape shape;
-
-    uint32_t color;
-    Square squares[SQUARE_NUMBER];
-    Square center;
-
-    Block();
-    Block(const Block& b);
-    void init();
-    uint32_t get_color();
-    void set_coords(int8_t x, int8_t y, uint8_t index);
-    void rotate(Direction d);
-    void move_left();
-    void move_right();
-    void move_down();
+    uint32_t time;
+    uint32_t frame;
 };
 
 
+/**
+* Game driver, feeds button input and time into the game core and renders it.
+* The logic side (tick) publishes frame snapshots that the render side
+* (render) draws, both can run on their own core or thread.
+*/
 class Tetris
 {
   private:
@@ -73,14 +54,25 @@ class Tetris
     static const uint16_t X_LEFT = 3;
     static const uint16_t X_RIGHT = 125;
     static const uint16_t SQUARE_WIDTH = 12;
-    static const uint8_t SQUARES_PER_COLUMN = (160 - Y_BOTTOM) / SQUARE_WIDTH;
-    static const uint8_t SQUARES_PER_ROW = 10;
+    static const uint8_t SQUARES_PER_COLUMN = GameCore::SQUARES_PER_COLUMN;
+    static const uint8_t SQUARES_PER_ROW = GameCore::SQUARES_PER_ROW;
     static const uint32_t BACKGROUND = TFT_DARKGREY;
-    
 
-    // Display refresh.
-    static const uint16_t FPS = 10;
-    static const float SPEED_TABLE[12];
+    // Text regions of score and level, they overlap the top playfield rows.
+    static const uint8_t SCORE_RIGHT = 121;
+    static const uint8_t SCORE_X = 49;
+    static const uint8_t LEVEL_RIGHT = 20;
+    static const uint8_t LEVEL_X = 0;
+    static const uint8_t TEXT_HEIGHT = DigitAtlas::MAX_HEIGHT;
+
+    static const uint8_t START_LEVEL = 6;
+    // Longest sleep when nothing is scheduled, keeps clock differences small.
+    static const uint16_t MAX_SLEEP_MS = 1000;
+    // Both rotate buttons held this long pause or continue the game.
+    static const uint8_t PAUSE_CHORD = GameCore::ROTATE_LEFT | GameCore::ROTATE_RIGHT;
+    static const uint16_t PAUSE_HOLD_MS = 1000;
+    // Frame period rounded up, the wake up interval while paused.
+    static const uint8_t FRAME_MS = (1000 + GameCore::FRAME_RATE - 1) / GameCore::FRAME_RATE;
 
 
     // Hardware pins.
@@ -89,74 +81,94 @@ class Tetris
     static const uint8_t PIN_ROTATE_LEFT = 19;
     static const uint8_t PIN_ROTATE_RIGHT = 21;
 
-    // Score data.
-    static const uint16_t ONE_LINE_POINTS = 40;
-    static const uint16_t TWO_LINES_POINTS = 100;
-    static const uint16_t THREE_LINES_POINTS = 300;
-    static const uint16_t FOUR_LINES_POINTS = 1200;
-
-
-    static const uint16_t DEBOUNCE_DELAY = 150;
-    static uint32_t debounce;
-
-    static bool move_left_flag;
-    static bool move_right_flag;
-    static bool rotate_left_flag;
-    static bool rotate_right_flag;
-
-    // User score from cleared lines.
-    uint32_t score;
-    // Current block speed level.
-    uint8_t level;
-    // Game over flag.
-    bool game_over;
-    // Delay between block steps.
-    uint16_t move_delay;
-    // Number of overall cleared lines.
-    uint16_t cleared_lines;
+    // Debounced presses from the button ISRs.
+    static InputQueue input_queue;
+    // Auto shift of held buttons, sampled once per tick.
+    AutoRepeat auto_repeat;
+    uint8_t last_held;
+
+    // Pause state and when it began, time the pause chord was first seen
+    // held and whether that hold already toggled.
+    bool paused;
+    uint32_t pause_time;
+    bool chord_held;
+    bool chord_used;
+    uint32_t chord_start;
+
+    // Game rules and state.
+    GameCore core;
+    // Time of the first frame and number of frames simulated since.
+    uint32_t start_time;
+    uint32_t frames_done;
 
     // Display interface.
     Display display;
 
-    // Playfield squares.
-    Square field_squares[SQUARES_PER_ROW][SQUARES_PER_COLUMN];
-
-    // Currently active block.
-    Block block;
+    // Bot that presses the buttons, nullptr for human play.
+    Autoplayer* autoplayer;
+    // Receives the inputs of every stepped frame, nullptr when not recording.
+    ReplayRecorder* recorder;
+    // Receives the game events of every stepped frame, nullptr when off.
+    Telemetry* telemetry;
+
+    // Time spent waiting for the next deadline and number of waits.
+    uint64_t idle_us;
+    uint32_t wakeups;
+
+    // Frames from the logic to the render side.
+    SpscRing<FrameSnapshot, 4> frames;
+    // Presses applied but not flushed yet, for the latency histogram. At most
+    // one per frame, so this covers a renderer a second behind.
+    SpscRing<InputStamp, 64> unshown_inputs;
+    // Frame time and latency counters.
+    FrameStats stats;
+    // Render from another core instead of from tick().
+    bool pipelined;
+    // Frame stepped but not published yet because the ring was full.
+    bool snapshot_pending;
+    // Storage holds an unfinished game, and a game over that still has to
+    // replace it there once the frame is drawn.
+    bool game_stored;
+    bool store_pending;
+
+    // Square colors, score and level as they were at the last flush.
+    uint16_t shown_colors[SQUARES_PER_COLUMN][SQUARES_PER_ROW];
+    uint32_t shown_score;
+    uint8_t shown_level;
 
 
     void init_button_isr();
-    void clear_flags();
+    FrameInputs take_inputs(uint32_t frame);
+    uint32_t frame_time(uint32_t frame);
+    uint8_t held_buttons();
     void run();
+    void tick();
+    uint32_t next_deadline();
+    void sleep();
+    bool publish();
+    bool render();
+    bool update_pause(uint8_t held);
+    void pause(bool on);
+    void save();
+    bool resume();
 
     static void move_left();
     static void move_right();
     static void rotate_left();
     static void rotate_right();
 
-    void move_block_left();
-    void move_block_right();
-    void move_block_downwards();
-    void rotate_block(Block::Direction d);
-    void update_score(uint8_t full_lines);
-    void finish_block();
-    void clear_full_lines();
-    void shift_field_down(uint8_t index);
-    void shift_line_down(uint8_t index);
-    void clear_line(uint8_t index);
-    bool block_finished();
-    bool intersect_borders(Block b);
-    bool intersection(Block b);
-    void fill_playfield();
-
-    void refresh_screen();
-    void draw_square(Square f);
-    void draw_current_block();
-    void draw_blocks();
+    void snapshot(FrameSnapshot& frame);
+    void refresh_screen(const FrameSnapshot& frame);
+    void compose_frame(uint16_t frame[SQUARES_PER_COLUMN][SQUARES_PER_ROW]);
+    void draw_square(uint8_t x, uint8_t y, uint16_t color);
+    void draw_blocks(const uint16_t frame[SQUARES_PER_COLUMN][SQUARES_PER_ROW], int8_t first[], int8_t last[]);
+    void draw_text_region(uint8_t x, uint8_t right, const uint16_t frame[SQUARES_PER_COLUMN][SQUARES_PER_ROW]);
     void draw_playfield();
+    void draw_score();
+    void draw_level();
 
 
     Tetris();
 };
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,79 @@
+#include "trace.h"
+#include <stdint.h>
+#include <string.h>
+
+
+const char* const Trace::NAMES[NAME_COUNT] = {"tick",           "move_block_downwards", "finish_block",
+                                              "clear_full_lines", "refresh_screen",     "flush"};
+
+
+/*
+ * Start of a dump, returns its size.
+ */
+uint8_t Trace::write_header(uint8_t* out)
+{
+    memcpy(out, "TTRC", 4);
+    out[4] = VERSION;
+    return HEADER_SIZE;
+}
+
+
+#if TETRIS_TRACE
+SpscRing<TraceSpan, Trace::SIZE> Trace::rings[CORES];
+bool Trace::armed[CORES];
+uint32_t Trace::dropped[CORES];
+
+
+/*
+ * Span from start until now on the calling core, nothing if it is not armed.
+ */
+void Trace::record(Name name, uint32_t start)
+{
+    uint8_t core = Platform::core();
+
+    if(core >= CORES || !armed[core])
+    {
+        return;
+    }
+
+    TraceSpan span = {start, Platform::profile_us() - start, name, core};
+
+    if(!rings[core].push(span))
+    {
+        dropped[core]++;
+    }
+}
+
+
+/*
+ * Consumer side, moves whole records of all cores into out and returns the
+ * number of bytes written.
+ */
+uint16_t Trace::flush(uint8_t* out, uint16_t size)
+{
+    uint16_t length = 0;
+
+    for(uint8_t core = 0; core < CORES; core++)
+    {
+        const TraceSpan* span;
+
+        while(length + RECORD_SIZE <= size && (span = rings[core].peek()))
+        {
+            uint8_t* p = out + length;
+
+            for(uint8_t i = 0; i < 4; i++)
+            {
+                p[i] = span->start >> (8 * i);
+                p[4 + i] = span->duration >> (8 * i);
+            }
+
+            p[8] = span->name;
+            p[9] = span->core;
+            rings[core].release();
+            length += RECORD_SIZE;
+        }
+    }
+
+    return length;
+}
+#endif
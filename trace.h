@@ -0,0 +1,124 @@
+#ifndef TRACE_H_
+#define TRACE_H_
+
+#include "platform.h"
+#include "spsc_ring.h"
+#include <stdint.h>
+
+// Set to 1 to record trace spans, compiled out otherwise.
+#ifndef TETRIS_TRACE
+#define TETRIS_TRACE 0
+#endif
+
+
+/**
+* Timed section of one core, microseconds on Platform::profile_us().
+*/
+struct TraceSpan
+{
+    uint32_t start;
+    uint32_t duration;
+    uint8_t name;
+    uint8_t core;
+};
+
+
+/**
+* Span tracer with one preallocated ring per core, each core is the only
+* producer of its ring and a single consumer drains them, so recording never
+* takes a lock. Spans are only recorded on an armed core: the driver arms
+* ticks and renders, so copies of the game core stepped by the bot stay out.
+* Spans that do not fit are counted per core in dropped.
+*
+* Dump: "TTRC", version, then records of start (u32), duration (u32), name
+* and core, little endian.
+*/
+class Trace
+{
+  public:
+    static const uint8_t VERSION = 1;
+    static const uint8_t HEADER_SIZE = 5;
+    static const uint8_t RECORD_SIZE = 10;
+    static const uint8_t CORES = 2;
+    static const uint16_t SIZE = 512;
+
+    enum Name : uint8_t
+    {
+        TICK,
+        MOVE_BLOCK_DOWNWARDS,
+        FINISH_BLOCK,
+        CLEAR_FULL_LINES,
+        REFRESH_SCREEN,
+        FLUSH,
+        NAME_COUNT
+    };
+
+    static const char* const NAMES[NAME_COUNT];
+
+    static uint8_t write_header(uint8_t* out);
+
+#if TETRIS_TRACE
+    static SpscRing<TraceSpan, SIZE> rings[CORES];
+    static bool armed[CORES];
+    static uint32_t dropped[CORES];
+
+    static void record(Name name, uint32_t start);
+    static uint16_t flush(uint8_t* out, uint16_t size);
+#endif
+};
+
+
+#if TETRIS_TRACE
+/*
+* Records a span from construction to the end of the scope.
+*/
+class TraceScope
+{
+  public:
+    explicit TraceScope(Trace::Name name) : name(name), start(Platform::profile_us()) {}
+    ~TraceScope() { Trace::record(name, start); }
+
+  private:
+    Trace::Name name;
+    uint32_t start;
+};
+
+
+/*
+* Arms or disarms the calling core until the end of the scope.
+*/
+class TraceArm
+{
+  public:
+    explicit TraceArm(bool on) : core(Platform::core()), previous(false)
+    {
+        if(core < Trace::CORES)
+        {
+            previous = Trace::armed[core];
+            Trace::armed[core] = on;
+        }
+    }
+
+    ~TraceArm()
+    {
+        if(core < Trace::CORES)
+        {
+            Trace::armed[core] = previous;
+        }
+    }
+
+  private:
+    uint8_t core;
+    bool previous;
+};
+
+#define TRACE_SPAN(name) TraceScope trace_span(Trace::name)
+#define TRACE_ARM() TraceArm trace_arm(true)
+#define TRACE_PAUSE() TraceArm trace_pause(false)
+#else
+#define TRACE_SPAN(name) ((void)0)
+#define TRACE_ARM() ((void)0)
+#define TRACE_PAUSE() ((void)0)
+#endif
+
+#endif
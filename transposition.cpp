@@ -0,0 +1,126 @@
+#include "transposition.h"
+#include <cstring>
+#include <stdint.h>
+
+
+/*
+ * Uses the largest power of two number of buckets that fits the memory.
+ */
+TranspositionTable::TranspositionTable(void* memory, size_t bytes)
+{
+    uintptr_t address = ((uintptr_t)memory + CACHE_LINE - 1) & ~(uintptr_t)(CACHE_LINE - 1);
+    size_t usable = bytes > address - (uintptr_t)memory ? bytes - (address - (uintptr_t)memory) : 0;
+    uint32_t count = 1;
+
+    while((size_t)count * 2 * sizeof(Bucket) <= usable)
+    {
+        count *= 2;
+    }
+
+    buckets = (Bucket*)address;
+    mask = usable >= sizeof(Bucket) ? count - 1 : 0;
+    age = 0;
+
+    if(usable < sizeof(Bucket))
+    {
+        buckets = nullptr;
+    }
+
+    clear();
+}
+
+
+void TranspositionTable::clear()
+{
+    if(buckets)
+    {
+        memset((void*)buckets, 0, (mask + 1) * sizeof(Bucket));
+    }
+}
+
+
+/*
+ * Ages existing entries so stale ones are replaced first.
+ */
+void TranspositionTable::new_search() { age++; }
+
+
+uint32_t TranspositionTable::check_of(uint64_t key, int32_t value, uint16_t best, uint8_t depth)
+{
+    return (uint32_t)(key >> 32) ^ (uint32_t)value ^ ((uint32_t)best << 8) ^ depth;
+}
+
+
+bool TranspositionTable::probe(uint64_t key, int32_t& value, uint16_t& best, uint8_t& depth) const
+{
+    if(!buckets)
+    {
+        return false;
+    }
+
+    const Bucket& bucket = buckets[(uint32_t)key & mask];
+
+    for(uint8_t i = 0; i < BUCKET_SIZE; i++)
+    {
+        const Entry& e = bucket.entries[i];
+        Entry copy;
+
+        memcpy(&copy, (const void*)&e, sizeof(copy));
+
+        if(copy.check && copy.check == check_of(key, copy.value, copy.best, copy.depth))
+        {
+            value = copy.value;
+            best = copy.best;
+            depth = copy.depth;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+
+/*
+ * Replaces the matching entry, else an empty one, else the oldest and
+ * shallowest entry of the bucket.
+ */
+void TranspositionTable::store(uint64_t key, int32_t value, uint16_t best, uint8_t depth)
+{
+    if(!buckets)
+    {
+        return;
+    }
+
+    Bucket& bucket = buckets[(uint32_t)key & mask];
+    Entry* victim = &bucket.entries[0];
+    int16_t victim_score = 0x7FFF;
+
+    for(uint8_t i = 0; i < BUCKET_SIZE; i++)
+    {
+        Entry& e = bucket.entries[i];
+
+        if(!e.check || e.check == check_of(key, e.value, e.best, e.depth))
+        {
+            victim = &e;
+            break;
+        }
+
+        int16_t score = e.depth - 4 * (uint8_t)(age - e.age);
+
+        if(score < victim_score)
+        {
+            victim = &e;
+            victim_score = score;
+        }
+    }
+
+    Entry entry;
+    entry.check = check_of(key, value, best, depth);
+    entry.value = value;
+    entry.best = best;
+    entry.depth = depth;
+    entry.age = age;
+    entry.reserved = 0;
+
+    memcpy((void*)victim, &entry, sizeof(entry));
+}
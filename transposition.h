@@ -0,0 +1,53 @@
+#ifndef TRANSPOSITION_H_
+#define TRANSPOSITION_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+
+/**
+* Fixed size hash table of evaluated positions keyed by Zobrist hash.
+* The memory is handed in by the owner, a static buffer on the device and
+* heap on the host, so the budget is set per build. Entries are grouped in
+* buckets of one cache line.
+*/
+class TranspositionTable
+{
+  public:
+    static const uint8_t BUCKET_SIZE = 4;
+    static const uint8_t CACHE_LINE = 64;
+
+    class Entry
+    {
+      public:
+        // Upper key half, xor'ed with the data so torn writes read as misses.
+        uint32_t check;
+        int32_t value;
+        uint16_t best;
+        uint8_t depth;
+        uint8_t age;
+        uint32_t reserved;
+    };
+
+    class alignas(CACHE_LINE) Bucket
+    {
+      public:
+        Entry entries[BUCKET_SIZE];
+    };
+
+    TranspositionTable(void* memory, size_t bytes);
+    void clear();
+    void new_search();
+    bool probe(uint64_t key, int32_t& value, uint16_t& best, uint8_t& depth) const;
+    void store(uint64_t key, int32_t value, uint16_t best, uint8_t depth);
+    uint32_t capacity() const { return (mask + 1) * BUCKET_SIZE; }
+
+  private:
+    Bucket* buckets;
+    uint32_t mask;
+    uint8_t age;
+
+    static uint32_t check_of(uint64_t key, int32_t value, uint16_t best, uint8_t depth);
+};
+
+#endif